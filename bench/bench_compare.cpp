@@ -0,0 +1,87 @@
+#include "compare.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+void usage() {
+	std::cerr << "bench_compare [--threshold PERCENT] [--sigmas N] baseline.json current.json\n"
+				 "Compares two sets of ppm_bench results benchmark by benchmark. A change only counts when it's bigger\n"
+				 "than --threshold percent of the baseline (default 5) and --sigmas times the noise of both runs\n"
+				 "(default 3), measured by the median absolute deviation of their samples.\n"
+				 "Exits with 1 if anything got slower, and 2 if the results couldn't be read.\n";
+}
+
+/*!
+ * @brief Read a results file
+ * @throws std::runtime_error If it can't be opened or read
+ */
+std::vector<bench_result> read_file(const std::string &path) {
+	auto in = std::ifstream{path};
+	if( !in.is_open()) { throw std::runtime_error("Unable to open " + path); }
+	try {
+		return read_results(in);
+	}
+	catch( const std::exception &e ) {
+		throw std::runtime_error(path + ": " + e.what());
+	}
+}
+
+}
+
+int main(const int argc, const char **argv) {
+	constexpr auto unreadable = 2;
+	auto opts = compare_options{};
+	auto files = std::vector<std::string>{};
+
+	for( auto i = 1; i < argc; i++ ) {
+		const auto arg = std::string{argv[i]};
+		if( arg == "--help" ) {
+			usage();
+			return EXIT_SUCCESS;
+		}
+		if( arg.rfind("--", 0) != 0 ) {
+			files.push_back(arg);
+			continue;
+		}
+		if( i + 1 >= argc ) {
+			usage();
+			return unreadable;
+		}
+		const auto value = std::string{argv[++i]};
+		try {
+			if( arg == "--threshold" ) { opts.threshold = std::stod(value) / 100; }
+			else if( arg == "--sigmas" ) { opts.sigmas = std::stod(value); }
+			else {
+				usage();
+				return unreadable;
+			}
+		}
+		catch( const std::exception & ) {
+			std::cerr << "Error: bad value " << value << " for " << arg << '\n';
+			return unreadable;
+		}
+	}
+	if( files.size() != 2 ) {
+		usage();
+		return unreadable;
+	}
+
+	auto comparisons = std::vector<comparison>{};
+	try {
+		comparisons = compare_results(read_file(files[0]), read_file(files[1]), opts);
+	}
+	catch( const std::exception &e ) {
+		std::cerr << e.what() << '\n';
+		return unreadable;
+	}
+
+	write_comparison(std::cout, comparisons);
+	const auto slower = std::count_if(comparisons.begin(), comparisons.end(),
+									  [](const comparison &c) { return c.result == verdict::SLOWER; });
+	const auto faster = std::count_if(comparisons.begin(), comparisons.end(),
+									  [](const comparison &c) { return c.result == verdict::FASTER; });
+	std::cout << faster << " faster, " << slower << " slower, " << comparisons.size() - faster - slower
+			  << " unchanged or not in both" << std::endl;
+	return slower == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,282 @@
+#include "compare.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+/*!
+ * @brief Just enough of a JSON value to read benchmark results
+ */
+struct json_value {
+	enum class type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+	type 										kind{type::NUL};
+	double 										number{0};
+	std::string 								text;
+	std::vector<json_value> 					items;
+	std::vector<std::pair<std::string, json_value>> members;
+
+	/*!
+	 * @brief The member with this key, or nullptr if there isn't one or this isn't an object
+	 */
+	const json_value *find(const std::string &key) const {
+		for( const auto &m: members ) {
+			if( m.first == key ) { return &m.second; }
+		}
+		return nullptr;
+	}
+};
+
+/*!
+ * @brief A recursive descent JSON parser over a whole document held in memory
+ */
+class json_parser {
+public:
+	explicit json_parser(std::string text)
+			: _text(std::move(text)) {}
+
+	json_value parse() {
+		auto value = _value();
+		_skip_space();
+		if( _pos != _text.size()) { _fail("trailing characters"); }
+		return value;
+	}
+
+private:
+	std::string _text;
+	std::size_t _pos{0};
+
+	[[noreturn]] void _fail(const std::string &what) const {
+		throw std::runtime_error("Bad JSON at character " + std::to_string(_pos) + ": " + what);
+	}
+
+	void _skip_space() {
+		while( _pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos]))) { _pos++; }
+	}
+
+	char _peek() {
+		_skip_space();
+		if( _pos == _text.size()) { _fail("unexpected end"); }
+		return _text[_pos];
+	}
+
+	void _expect(const char c) {
+		if( _peek() != c ) { _fail(std::string{"expected "} + c); }
+		_pos++;
+	}
+
+	void _literal(const std::string &word) {
+		if( _text.compare(_pos, word.size(), word) != 0 ) { _fail("expected " + word); }
+		_pos += word.size();
+	}
+
+	json_value _value() {
+		auto value = json_value{};
+		const auto c = _peek();
+		if( c == '{' ) {
+			value.kind = json_value::type::OBJECT;
+			_pos++;
+			if( _peek() == '}' ) {
+				_pos++;
+				return value;
+			}
+			do {
+				auto key = _string();
+				_expect(':');
+				value.members.emplace_back(std::move(key), _value());
+			} while( _comma());
+			_expect('}');
+		}
+		else if( c == '[' ) {
+			value.kind = json_value::type::ARRAY;
+			_pos++;
+			if( _peek() == ']' ) {
+				_pos++;
+				return value;
+			}
+			do {
+				value.items.push_back(_value());
+			} while( _comma());
+			_expect(']');
+		}
+		else if( c == '"' ) {
+			value.kind = json_value::type::STRING;
+			value.text = _string();
+		}
+		else if( c == 't' || c == 'f' ) {
+			value.kind = json_value::type::BOOLEAN;
+			value.number = c == 't';
+			_literal(c == 't' ? "true" : "false");
+		}
+		else if( c == 'n' ) {
+			_literal("null");
+		}
+		else {
+			value.kind = json_value::type::NUMBER;
+			value.number = _number();
+		}
+		return value;
+	}
+
+	bool _comma() {
+		if( _peek() != ',' ) { return false; }
+		_pos++;
+		return true;
+	}
+
+	std::string _string() {
+		_expect('"');
+		auto s = std::string{};
+		while( _pos < _text.size() && _text[_pos] != '"' ) {
+			auto c = _text[_pos++];
+			if( c == '\\' ) {
+				if( _pos == _text.size()) { break; }
+				c = _text[_pos++];
+				// The names written are plain ASCII, so the other escapes are kept as they are
+				if( c == 'n' ) { c = '\n'; }
+				else if( c == 't' ) { c = '\t'; }
+			}
+			s += c;
+		}
+		if( _pos == _text.size()) { _fail("unterminated string"); }
+		_pos++;
+		return s;
+	}
+
+	double _number() {
+		const auto start = _pos;
+		while( _pos < _text.size() && (std::isdigit(static_cast<unsigned char>(_text[_pos])) ||
+									   std::string_view{"+-.eE"}.find(_text[_pos]) != std::string_view::npos)) {
+			_pos++;
+		}
+		if( start == _pos ) { _fail("unexpected character"); }
+		// stod stops at the first character it can't use, so 1.2.3 would quietly be 1.2
+		const auto token = _text.substr(start, _pos - start);
+		auto used = std::size_t{0};
+		auto n = 0.0;
+		try {
+			n = std::stod(token, &used);
+		}
+		catch( const std::exception & ) {}
+		if( used != token.size()) {
+			_pos = start;
+			_fail("bad number");
+		}
+		return n;
+	}
+};
+
+double number_member(const json_value &object, const std::string &key) {
+	const auto *value = object.find(key);
+	return value && value->kind == json_value::type::NUMBER ? value->number : 0;
+}
+
+/*!
+ * @brief Scale a MAD so it estimates the standard deviation of normally distributed samples
+ */
+constexpr auto mad_to_sigma = 1.4826;
+
+const char *verdict_name(const verdict v) {
+	switch( v ) {
+		case verdict::SAME: return "same";
+		case verdict::FASTER: return "faster";
+		case verdict::SLOWER: return "SLOWER";
+		case verdict::ADDED: return "added";
+		case verdict::REMOVED: return "removed";
+	}
+	return "";
+}
+
+}
+
+std::vector<bench_result> read_results(std::istream &is) {
+	const auto document = json_parser{std::string{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}}}.parse();
+	const auto *benchmarks = document.find("benchmarks");
+	if( !benchmarks || benchmarks->kind != json_value::type::ARRAY ) {
+		throw std::runtime_error("No \"benchmarks\" array, is this from ppm_bench?");
+	}
+
+	auto results = std::vector<bench_result>{};
+	for( const auto &b: benchmarks->items ) {
+		const auto *name = b.find("name");
+		if( !name || name->kind != json_value::type::STRING ) { throw std::runtime_error("A benchmark has no name"); }
+		auto r = bench_result{};
+		r.name = name->text;
+		r.size = static_cast<int>(number_member(b, "size"));
+		r.pixels = static_cast<std::uint64_t>(number_member(b, "pixels"));
+		r.bytes = static_cast<std::uint64_t>(number_member(b, "bytes"));
+		if( const auto *samples = b.find("samples")) {
+			for( const auto &s: samples->items ) { r.samples.push_back(s.number); }
+		}
+		// Without the samples the median is all there is to go on
+		if( r.samples.empty()) { r.samples.push_back(number_member(b, "median")); }
+		results.push_back(std::move(r));
+	}
+	return results;
+}
+
+std::vector<comparison> compare_results(const std::vector<bench_result> &baseline,
+										const std::vector<bench_result> &current, const compare_options &opts) {
+	const auto find = [](const std::vector<bench_result> &in, const bench_result &r) {
+		return std::find_if(in.begin(), in.end(), [&](const bench_result &c) { return c.name == r.name && c.size == r.size; });
+	};
+
+	auto comparisons = std::vector<comparison>{};
+	for( const auto &b: baseline ) {
+		auto c = comparison{};
+		c.name = b.name;
+		c.size = b.size;
+		c.baseline = b.median();
+		const auto match = find(current, b);
+		if( match == current.end()) {
+			c.result = verdict::REMOVED;
+			comparisons.push_back(c);
+			continue;
+		}
+		c.current = match->median();
+		if( c.baseline <= 0 ) {
+			comparisons.push_back(c);
+			continue;
+		}
+		c.change = c.current / c.baseline - 1;
+		const auto spread = mad_to_sigma * std::hypot(b.mad(), match->mad());
+		c.noise = std::max(opts.threshold, opts.sigmas * spread / c.baseline);
+		if( std::fabs(c.change) > c.noise ) { c.result = c.change < 0 ? verdict::FASTER : verdict::SLOWER; }
+		comparisons.push_back(c);
+	}
+	for( const auto &r: current ) {
+		if( find(baseline, r) != baseline.end()) { continue; }
+		auto c = comparison{};
+		c.name = r.name;
+		c.size = r.size;
+		c.current = r.median();
+		c.result = verdict::ADDED;
+		comparisons.push_back(c);
+	}
+	return comparisons;
+}
+
+void write_comparison(std::ostream &os, const std::vector<comparison> &comparisons) {
+	os << std::left << std::setw(20) << "benchmark" << std::right << std::setw(8) << "size"
+	   << std::setw(14) << "baseline s" << std::setw(14) << "current s" << std::setw(10) << "change"
+	   << std::setw(10) << "noise" << std::setw(10) << "speedup" << "  verdict\n";
+	for( const auto &c: comparisons ) {
+		os << std::left << std::setw(20) << c.name << std::right << std::setw(8) << c.size << std::setprecision(4)
+		   << std::setw(14) << c.baseline << std::setw(14) << c.current;
+		if( c.result == verdict::ADDED || c.result == verdict::REMOVED ) {
+			os << std::setw(30) << "";
+		}
+		else {
+			os << std::fixed << std::setprecision(1) << std::showpos << std::setw(9) << c.change * 100 << "%"
+			   << std::noshowpos << std::setw(9) << c.noise * 100 << "%"
+			   << std::setprecision(2) << std::setw(9) << (c.current > 0 ? c.baseline / c.current : 0) << "x"
+			   << std::defaultfloat;
+		}
+		os << "  " << verdict_name(c.result) << "\n";
+	}
+}
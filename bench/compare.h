@@ -0,0 +1,68 @@
+#ifndef SONGSIM_COMPARE_H
+#define SONGSIM_COMPARE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "harness.h"
+
+/*!
+ * @brief Read the results written by bench_harness::write_json
+ * @param is The stream to read from
+ * @return The name, size, pixels, bytes and samples of each benchmark
+ * @throws std::runtime_error If it isn't valid JSON or doesn't look like benchmark results
+ */
+std::vector<bench_result> read_results(std::istream& is);
+
+/*!
+ * @brief How a benchmark changed between two sets of results
+ */
+enum class verdict {
+	SAME,		/*! Any change is within the noise 	*/
+	FASTER,
+	SLOWER,
+	ADDED,		/*! Only in the new results 		*/
+	REMOVED		/*! Only in the baseline 			*/
+};
+
+/*!
+ * @brief One benchmark in both sets of results
+ */
+struct comparison {
+	std::string name;
+	int 		size{0};
+	double 		baseline{0};	/*! Median seconds in the baseline 							*/
+	double 		current{0};		/*! Median seconds in the new results 						*/
+	double 		change{0};		/*! current / baseline - 1, so negative is faster 			*/
+	double 		noise{0};		/*! The smallest change that counts, as a fraction of baseline 	*/
+	verdict 	result{verdict::SAME};
+};
+
+/*!
+ * @brief How big a change has to be before it counts
+ */
+struct compare_options {
+	/*! Changes smaller than this fraction of the baseline never count, however quiet the runs were */
+	double threshold{0.05};
+	/*! How many (normal scaled) MADs of both runs the change has to be bigger than */
+	double sigmas{3};
+};
+
+/*!
+ * @brief Compare the medians of every benchmark in two sets of results.
+ * A change only counts when it's bigger than both the threshold and the noise of the runs, so noisy
+ * benchmarks need a bigger change before they're called faster or slower.
+ * @param baseline The results to compare against
+ * @param current The new results
+ * @param opts How big a change has to be
+ * @return Each benchmark, in the order they're in the baseline followed by any added ones
+ */
+std::vector<comparison> compare_results(const std::vector<bench_result>& baseline,
+										const std::vector<bench_result>& current, const compare_options& opts = {});
+
+/*!
+ * @brief Write a table of the comparisons for people to read
+ */
+void write_comparison(std::ostream& os, const std::vector<comparison>& comparisons);
+
+#endif //SONGSIM_COMPARE_H
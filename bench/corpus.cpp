@@ -0,0 +1,101 @@
+#include "corpus.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+/*!
+ * @brief Draws word ranks from a Zipf distribution
+ */
+class zipf_words {
+public:
+	zipf_words(const int vocabulary, const double exponent, const std::uint64_t seed)
+			: _cdf(static_cast<std::size_t>(std::max(1, vocabulary))), _gen(seed) {
+		auto total = 0.0;
+		for( std::size_t rank = 0; rank < _cdf.size(); rank++ ) {
+			total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+			_cdf[rank] = total;
+		}
+		for( auto &c: _cdf ) { c /= total; }
+	}
+
+	/*!
+	 * @brief The rank of the next word, 0 is the most common
+	 */
+	std::size_t next() {
+		// Built from the raw bits, as the standard distributions can differ between libraries
+		const auto u = static_cast<double>(_gen() >> 11) * 0x1.0p-53;
+		const auto it = std::upper_bound(_cdf.begin(), _cdf.end(), u);
+		return std::min(static_cast<std::size_t>(it - _cdf.begin()), _cdf.size() - 1);
+	}
+
+private:
+	std::vector<double> _cdf;
+	std::mt19937_64 	_gen;
+};
+
+/*!
+ * @brief A pronounceable made up word, different for every rank
+ */
+std::string word_for(std::size_t rank) {
+	static const char *syllables[] = {
+			"la", "na", "ba", "do", "ri", "mo", "ka", "se", "tu", "vi", "yo", "ze", "pa", "ho", "gi", "fe"
+	};
+	auto word = std::string{};
+	do {
+		word += syllables[rank % 16];
+		rank /= 16;
+	} while( rank > 0 );
+	return word;
+}
+
+}
+
+void generate_corpus(std::ostream &os, const corpus_options &opts) {
+	auto words = zipf_words{opts.vocabulary, opts.zipf, opts.seed};
+	const auto line_words = std::max(1, opts.line_words);
+	const auto verse_words = static_cast<std::uint64_t>(line_words) * std::max(1, opts.verse_lines);
+	const auto chorus_words = static_cast<std::size_t>(line_words) * std::max(0, opts.chorus_lines);
+
+	// Spelling out every word would be slow for huge texts, so each rank's spelling is kept
+	auto spelling = std::vector<std::string>(static_cast<std::size_t>(std::max(1, opts.vocabulary)));
+	const auto spell = [&](const std::size_t rank) -> const std::string & {
+		if( spelling[rank].empty()) { spelling[rank] = word_for(rank); }
+		return spelling[rank];
+	};
+
+	auto chorus = std::vector<std::size_t>{};
+	auto written = std::uint64_t{0};
+	auto section = 0;
+	const auto put = [&](const std::size_t rank) {
+		os << spell(rank) << (++written % static_cast<std::uint64_t>(line_words) == 0 ? '\n' : ' ');
+	};
+
+	while( written < opts.words ) {
+		const auto sections = std::max(1, opts.sections);
+		if( section % sections == 0 ) {
+			// A new song, with a new chorus
+			chorus.clear();
+			for( std::size_t w = 0; w < chorus_words; w++ ) { chorus.push_back(words.next()); }
+			if( section > 0 ) { os << '\n'; }
+		}
+
+		if( section % 2 == 1 && !chorus.empty()) {
+			for( std::size_t w = 0; w < chorus.size() && written < opts.words; w++ ) { put(chorus[w]); }
+		}
+		else {
+			for( std::uint64_t w = 0; w < verse_words && written < opts.words; w++ ) { put(words.next()); }
+		}
+		section++;
+	}
+	if( written % static_cast<std::uint64_t>(line_words) != 0 ) { os << '\n'; }
+}
+
+std::string make_corpus(const corpus_options &opts) {
+	auto os = std::ostringstream{};
+	generate_corpus(os, opts);
+	return os.str();
+}
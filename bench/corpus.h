@@ -0,0 +1,37 @@
+#ifndef SONGSIM_CORPUS_H
+#define SONGSIM_CORPUS_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/*!
+ * @brief The shape of a made up text
+ */
+struct corpus_options {
+	std::uint64_t 	words{10000};		/*! How many words in total 								*/
+	int 			vocabulary{5000};	/*! How many different words can be used in verses 			*/
+	double 			zipf{1.0};			/*! How skewed word use is, the nth most common word is
+ 											used 1/n^zipf as often as the most common one 			*/
+	int 			line_words{8};		/*! Words on each line 										*/
+	int 			verse_lines{8};		/*! Lines in each verse 									*/
+	int 			chorus_lines{4};	/*! Lines in the chorus, 0 for no chorus 					*/
+	int 			sections{6};		/*! Verses and choruses per song before a new chorus is made 	*/
+	std::uint64_t 	seed{1};			/*! The same seed and options always give the same text 	*/
+};
+
+/*!
+ * @brief Write a made up text shaped like song lyrics: verses of words drawn from a Zipf distribution,
+ * alternating with a chorus which is repeated word for word until the song ends and a new one starts.
+ * The output only depends on the options, not the platform or standard library.
+ * @param os Where to write the text
+ * @param opts The shape of the text
+ */
+void generate_corpus(std::ostream& os, const corpus_options& opts);
+
+/*!
+ * @brief Make a text in memory, see generate_corpus
+ */
+std::string make_corpus(const corpus_options& opts);
+
+#endif //SONGSIM_CORPUS_H
@@ -0,0 +1,160 @@
+#include "harness.h"
+#include "counting_resource.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+
+double median_of(std::vector<double> v) {
+	if( v.empty()) { return 0; }
+	std::sort(v.begin(), v.end());
+	const auto mid = v.size() / 2;
+	return v.size() % 2 ? v[mid] : (v[mid - 1] + v[mid]) / 2;
+}
+
+std::string escaped(const std::string &s) {
+	auto out = std::string{};
+	for( const auto c: s ) {
+		if( c == '"' || c == '\\' ) { out += '\\'; }
+		out += c;
+	}
+	return out;
+}
+
+}
+
+double bench_result::median() const {
+	return median_of(samples);
+}
+
+double bench_result::mad() const {
+	const auto m = median();
+	auto deviations = samples;
+	for( auto &d: deviations ) { d = std::fabs(d - m); }
+	return median_of(deviations);
+}
+
+bench_harness::bench_harness(const int reps, std::string filter, const bool counters)
+		: _reps(std::max(1, reps)), _filter(std::move(filter)) {
+	if( !counters ) { return; }
+	_counters = std::make_unique<perf_counters>();
+	if( !_counters->available()) {
+		std::cerr << "Hardware counters aren't available (" << _counters->error() << "), carrying on without them\n";
+		_counters.reset();
+	}
+}
+
+bench_harness::~bench_harness() = default;
+
+bool bench_harness::wanted(const std::string &name) const {
+	return name.find(_filter) != std::string::npos;
+}
+
+void bench_harness::run(const std::string &name, const int size, const std::uint64_t pixels, const std::uint64_t bytes,
+						const std::function<void()> &f) {
+	if( !wanted(name)) { return; }
+
+	auto result = bench_result{};
+	result.name = name;
+	result.size = size;
+	result.pixels = pixels;
+	result.bytes = bytes;
+	auto counter = counting_resource{};
+	constexpr auto events = static_cast<int>(perf_counters::event::COUNT);
+	auto counts = std::vector<std::vector<double>>(events);
+	f();
+	for( auto rep = 0; rep < _reps; rep++ ) {
+		counter.reset();
+		auto *previous = std::pmr::set_default_resource(&counter);
+		if( _counters ) { _counters->start(); }
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		result.samples.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		if( _counters ) {
+			const auto reading = _counters->stop();
+			for( auto e = 0; e < events; e++ ) {
+				if( reading.valid[e] ) { counts[e].push_back(static_cast<double>(reading.values[e])); }
+			}
+		}
+		std::pmr::set_default_resource(previous);
+	}
+	for( auto e = 0; e < events; e++ ) {
+		if( counts[e].empty()) { continue; }
+		result.counters.emplace_back(perf_counters::name(static_cast<perf_counters::event>(e)), median_of(counts[e]));
+	}
+	result.allocations = counter.allocations();
+	result.allocated = counter.bytes();
+	result.peak = counter.high_water();
+	std::cerr << name << " " << size << ": " << result.median() << "s\n";
+	_results.push_back(std::move(result));
+}
+
+void bench_harness::write_json(std::ostream &os) const {
+	os << std::setprecision(9) << "{\n  \"reps\": " << _reps << ",\n  \"benchmarks\": [\n";
+	for( std::size_t i = 0; i < _results.size(); i++ ) {
+		const auto &r = _results[i];
+		const auto m = r.median();
+		os << "    {\"name\": \"" << escaped(r.name) << "\", \"size\": " << r.size
+		   << ", \"pixels\": " << r.pixels << ", \"bytes\": " << r.bytes
+		   << ", \"median\": " << m << ", \"mad\": " << r.mad()
+		   << ", \"pixels_per_second\": " << (m > 0 ? r.pixels / m : 0)
+		   << ", \"mb_per_second\": " << (m > 0 ? r.bytes / m / 1e6 : 0)
+		   << ", \"allocations\": " << r.allocations << ", \"allocated_bytes\": " << r.allocated
+		   << ", \"peak_allocated_bytes\": " << r.peak;
+		if( !r.counters.empty()) {
+			os << ", \"counters\": {";
+			for( std::size_t c = 0; c < r.counters.size(); c++ ) {
+				os << (c ? ", " : "") << "\"" << r.counters[c].first << "\": " << r.counters[c].second;
+			}
+			os << "}, \"per_pixel\": {";
+			for( std::size_t c = 0; c < r.counters.size(); c++ ) {
+				os << (c ? ", " : "") << "\"" << r.counters[c].first << "\": "
+				   << (r.pixels ? r.counters[c].second / static_cast<double>(r.pixels) : 0);
+			}
+			os << "}";
+		}
+		os
+		   << ", \"samples\": [";
+		for( std::size_t s = 0; s < r.samples.size(); s++ ) {
+			os << (s ? ", " : "") << r.samples[s];
+		}
+		os << "]}" << (i + 1 < _results.size() ? "," : "") << "\n";
+	}
+	os << "  ]\n}\n";
+}
+
+void bench_harness::write_summary(std::ostream &os) const {
+	os << std::left << std::setw(20) << "benchmark" << std::right << std::setw(8) << "size"
+	   << std::setw(12) << "median s" << std::setw(10) << "mad %" << std::setw(14) << "Mpixels/s" << std::setw(10) << "MB/s"
+	   << std::setw(10) << "allocs" << std::setw(12) << "peak MB";
+	if( _counters ) {
+		os << std::setw(10) << "cyc/px" << std::setw(8) << "IPC" << std::setw(12) << "cmiss/px" << std::setw(12) << "bmiss/px";
+	}
+	os << "\n";
+	for( const auto &r: _results ) {
+		const auto m = r.median();
+		os << std::left << std::setw(20) << r.name << std::right << std::setw(8) << r.size
+		   << std::setw(12) << std::setprecision(4) << m
+		   << std::setw(10) << std::setprecision(3) << (m > 0 ? 100 * r.mad() / m : 0)
+		   << std::setw(14) << std::setprecision(4) << (m > 0 ? r.pixels / m / 1e6 : 0)
+		   << std::setw(10) << (m > 0 && r.bytes ? r.bytes / m / 1e6 : 0)
+		   << std::setw(10) << r.allocations << std::setw(12) << r.peak / 1e6;
+		if( _counters ) {
+			const auto count = [&](const perf_counters::event e) {
+				for( const auto &c: r.counters ) {
+					if( c.first == perf_counters::name(e)) { return c.second; }
+				}
+				return 0.0;
+			};
+			const auto px = r.pixels ? static_cast<double>(r.pixels) : 1.0;
+			const auto cycles = count(perf_counters::event::CYCLES);
+			os << std::setw(10) << cycles / px
+			   << std::setw(8) << (cycles > 0 ? count(perf_counters::event::INSTRUCTIONS) / cycles : 0)
+			   << std::setw(12) << count(perf_counters::event::CACHE_MISSES) / px
+			   << std::setw(12) << count(perf_counters::event::BRANCH_MISSES) / px;
+		}
+		os << "\n";
+	}
+}
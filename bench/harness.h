@@ -0,0 +1,111 @@
+#ifndef SONGSIM_HARNESS_H
+#define SONGSIM_HARNESS_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+#include "perf_counters.h"
+
+/*!
+ * @brief The timings of one benchmark at one size
+ */
+struct bench_result {
+	std::string 		name;		/*! What was measured 									*/
+	int 				size{0};	/*! The width of the image, or the number of words 		*/
+	std::uint64_t 		pixels{0};	/*! Pixels processed by each run 						*/
+	std::uint64_t 		bytes{0};	/*! Bytes written or pixel data touched by each run 	*/
+	std::vector<double> samples;	/*! Seconds taken by each run 							*/
+	std::uint64_t 		allocations{0};	/*! Image allocations made by a run 				*/
+	std::uint64_t 		allocated{0};	/*! Bytes of image allocations made by a run 		*/
+	std::uint64_t 		peak{0};		/*! Most bytes of images allocated at once in a run 	*/
+	/*! The median of each hardware counter over the runs, empty if they weren't read */
+	std::vector<std::pair<std::string, double>> counters;
+
+	/*!
+	 * @brief The middle sample
+	 */
+	double median() const;
+
+	/*!
+	 * @brief The median absolute deviation of the samples from their median, a measure of noise
+	 */
+	double mad() const;
+};
+
+/*!
+ * @brief Runs benchmarks a number of times and collects the results
+ */
+class bench_harness {
+public:
+	/*!
+	 * @param reps How many timed runs of each benchmark, after one untimed warm up run
+	 * @param filter Only run benchmarks whose name contains this
+	 * @param counters Whether to read the hardware performance counters around each run, where they're available
+	 */
+	explicit bench_harness(int reps, std::string filter = "", bool counters = false);
+	~bench_harness();
+
+	/*!
+	 * @brief Time a benchmark.
+	 * While it runs, a counting_resource is the default memory resource so the image allocations are counted.
+	 * @param name What's being measured
+	 * @param size The width of the image, or the number of words
+	 * @param pixels How many pixels each run processes
+	 * @param bytes How many bytes each run writes, or how much pixel data it touches
+	 * @param f One run of the benchmark
+	 */
+	void run(const std::string& name, int size, std::uint64_t pixels, std::uint64_t bytes, const std::function<void()>& f);
+
+	/*!
+	 * @brief Whether a benchmark would be run, so its set up can be skipped if not
+	 */
+	bool wanted(const std::string& name) const;
+
+	/*!
+	 * @brief Write every result as JSON, including the samples so runs can be compared later
+	 */
+	void write_json(std::ostream& os) const;
+
+	/*!
+	 * @brief Write a table of the results for people to read
+	 */
+	void write_summary(std::ostream& os) const;
+
+	const std::vector<bench_result>& results() const { return _results; }
+
+private:
+	int 							_reps;
+	std::string 					_filter;
+	std::vector<bench_result> 		_results;
+	std::unique_ptr<perf_counters> 	_counters;
+};
+
+/*!
+ * @brief A stream buffer which throws away everything written to it, only counting the bytes.
+ * Used so the writers are measured rather than the disk, it still buffers like a file would.
+ */
+class counting_buf : public std::streambuf {
+public:
+	counting_buf() { setp(_buffer, _buffer + sizeof(_buffer)); }
+
+	std::uint64_t count() const { return _count + static_cast<std::uint64_t>(pptr() - pbase()); }
+
+protected:
+	int_type overflow(const int_type c) override {
+		_count += static_cast<std::uint64_t>(pptr() - pbase());
+		setp(_buffer, _buffer + sizeof(_buffer));
+		if( c != traits_type::eof()) { sputc(traits_type::to_char_type(c)); }
+		return traits_type::not_eof(c);
+	}
+
+private:
+	char 			_buffer[1 << 16];
+	std::uint64_t 	_count{0};
+};
+
+#endif //SONGSIM_HARNESS_H
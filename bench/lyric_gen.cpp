@@ -0,0 +1,61 @@
+#include "corpus.h"
+#include <fstream>
+#include <string>
+
+namespace {
+
+void usage() {
+	std::cerr << "lyric_gen [--words N] [--vocab N] [--zipf S] [--line-words N] [--verse-lines N]\n"
+				 "          [--chorus-lines N] [--sections N] [--seed N] [--out file]\n"
+				 "Writes made up song lyrics for testing how SongSim scales, to --out or stdout.\n"
+				 "The same options and seed always give the same text.\n";
+}
+
+}
+
+int main(const int argc, const char **argv) {
+	auto opts = corpus_options{};
+	auto out = std::string{};
+
+	for( auto i = 1; i < argc; i++ ) {
+		const auto arg = std::string{argv[i]};
+		if( arg == "--help" || i + 1 >= argc ) {
+			usage();
+			return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		const auto value = std::string{argv[++i]};
+		try {
+			if( arg == "--words" ) { opts.words = std::stoull(value); }
+			else if( arg == "--vocab" ) { opts.vocabulary = std::stoi(value); }
+			else if( arg == "--zipf" ) { opts.zipf = std::stod(value); }
+			else if( arg == "--line-words" ) { opts.line_words = std::stoi(value); }
+			else if( arg == "--verse-lines" ) { opts.verse_lines = std::stoi(value); }
+			else if( arg == "--chorus-lines" ) { opts.chorus_lines = std::stoi(value); }
+			else if( arg == "--sections" ) { opts.sections = std::stoi(value); }
+			else if( arg == "--seed" ) { opts.seed = std::stoull(value); }
+			else if( arg == "--out" ) { out = value; }
+			else {
+				usage();
+				return EXIT_FAILURE;
+			}
+		}
+		catch( const std::exception & ) {
+			std::cerr << "Error: bad value " << value << " for " << arg << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( out.empty()) {
+		std::ios::sync_with_stdio(false);
+		generate_corpus(std::cout, opts);
+		return std::cout ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	auto file = std::ofstream{out};
+	generate_corpus(file, opts);
+	if( !file ) {
+		std::cerr << "Unable to write " << out << '\n';
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "perf_counters.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr auto event_count = static_cast<int>(perf_counters::event::COUNT);
+}
+
+#ifdef __linux__
+
+perf_counters::perf_counters() {
+	static const std::uint64_t configs[] = {
+			PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+	};
+	for( auto e = 0; e < event_count; e++ ) {
+		struct perf_event_attr attr{};
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = configs[e];
+		attr.disabled = 1;
+		// Only user space is counted, which is all an unprivileged process is usually allowed
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// Count any threads the benchmark starts as well
+		attr.inherit = 1;
+		_fds[e] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+		if( _fds[e] < 0 && _error.empty()) { _error = std::strerror(errno); }
+	}
+	if( available()) { _error.clear(); }
+}
+
+perf_counters::~perf_counters() {
+	for( const auto fd: _fds ) {
+		if( fd >= 0 ) { close(fd); }
+	}
+}
+
+void perf_counters::start() {
+	for( const auto fd: _fds ) {
+		if( fd < 0 ) { continue; }
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+perf_counters::reading perf_counters::stop() {
+	auto r = reading{};
+	for( auto e = 0; e < event_count; e++ ) {
+		if( _fds[e] < 0 ) { continue; }
+		ioctl(_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+		auto value = std::uint64_t{0};
+		r.valid[e] = read(_fds[e], &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value));
+		r.values[e] = value;
+	}
+	return r;
+}
+
+#else
+
+perf_counters::perf_counters() {
+	_fds.fill(-1);
+	_error = "only supported on Linux";
+}
+
+perf_counters::~perf_counters() = default;
+
+void perf_counters::start() {}
+
+perf_counters::reading perf_counters::stop() {
+	return reading{};
+}
+
+#endif
+
+bool perf_counters::available() const {
+	for( const auto fd: _fds ) {
+		if( fd >= 0 ) { return true; }
+	}
+	return false;
+}
+
+std::string perf_counters::name(const event e) {
+	switch( e ) {
+		case event::CYCLES: return "cycles";
+		case event::INSTRUCTIONS: return "instructions";
+		case event::CACHE_MISSES: return "cache_misses";
+		case event::BRANCH_MISSES: return "branch_misses";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef SONGSIM_PERF_COUNTERS_H
+#define SONGSIM_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*!
+ * @brief The hardware performance counters of this thread and any threads it starts, read through perf_event_open
+ * on Linux.
+ * Counters the kernel won't give us, as is often the case in containers and virtual machines,
+ * are just left out, and on other platforms none are available.
+ */
+class perf_counters {
+public:
+	/*!
+	 * @brief The events counted
+	 */
+	enum class event { CYCLES = 0, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, COUNT };
+
+	/*!
+	 * @brief The counts from one start/stop
+	 */
+	struct reading {
+		std::array<std::uint64_t, static_cast<int>(event::COUNT)> 	values{};
+		std::array<bool, static_cast<int>(event::COUNT)> 			valid{};
+	};
+
+	/*!
+	 * @brief Open every counter the kernel allows
+	 */
+	perf_counters();
+	~perf_counters();
+
+	perf_counters(const perf_counters&) = delete;
+	perf_counters& operator=(const perf_counters&) = delete;
+
+	/*!
+	 * @brief Whether any of the counters could be opened
+	 */
+	bool available() const;
+
+	/*!
+	 * @brief Zero the counters and start counting
+	 */
+	void start();
+
+	/*!
+	 * @brief Stop counting and read the counters
+	 * @return What was counted since start
+	 */
+	reading stop();
+
+	/*!
+	 * @brief The name of an event, as used in the results
+	 */
+	static std::string name(event e);
+
+	/*!
+	 * @brief Why no counters are available, empty if some are
+	 */
+	const std::string& error() const { return _error; }
+
+private:
+	std::array<int, static_cast<int>(event::COUNT)> _fds{};
+	std::string 									_error;
+};
+
+#endif //SONGSIM_PERF_COUNTERS_H
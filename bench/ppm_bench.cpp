@@ -0,0 +1,232 @@
+#include "harness.h"
+#include "corpus.h"
+#include "ppm_file.h"
+#include "resize.h"
+#include "blur.h"
+#include "image_stats.h"
+#include "transform.h"
+#include "lut.h"
+#include "quantise.h"
+#include "image_compare.h"
+#include "png.h"
+#include "qoi.h"
+#include "song_sim.h"
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+/*!
+ * @brief Read a comma separated list of numbers
+ */
+std::vector<int> parse_list(const std::string &text) {
+	auto values = std::vector<int>{};
+	auto in = std::istringstream{text};
+	auto item = std::string{};
+	while( std::getline(in, item, ',')) {
+		if( !item.empty()) { values.push_back(std::stoi(item)); }
+	}
+	return values;
+}
+
+void image_benchmarks(bench_harness &harness, const int size) {
+	const auto pixels = static_cast<std::uint64_t>(size) * size;
+	const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+	const auto red = rgb_pixel::get_colour(rgb_pixel::colours::RED);
+
+	harness.run("construct", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+		const auto p = ppm_image{image_size{size, size}, white};
+		if( p.size().width() != size ) { std::abort(); }
+	});
+
+	harness.run("insert", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+		auto p = ppm_image{};
+		for( auto row = 0; row < size; row++ ) {
+			p.new_line();
+			for( auto col = 0; col < size; col++ ) { p << red; }
+		}
+	});
+
+	auto p = ppm_image{image_size{size, size}, white};
+	if( harness.wanted("access")) {
+		// Visit every pixel once, in a random order
+		auto order = std::vector<std::uint32_t>(pixels);
+		for( std::uint32_t i = 0; i < order.size(); i++ ) { order[i] = i; }
+		std::shuffle(order.begin(), order.end(), std::mt19937{7});
+		harness.run("access", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+			for( const auto i: order ) {
+				auto &pixel = p[static_cast<int>(i / size)][i % size];
+				pixel.red()++;
+			}
+		});
+	}
+
+	// Thumbnails an eighth of the size
+	const auto thumb = image_size{std::max(1, size / 8), std::max(1, size / 8)};
+	for( const auto filter: {resize_filter::NEAREST, resize_filter::BOX, resize_filter::BILINEAR} ) {
+		const auto name = std::string{filter == resize_filter::NEAREST ? "resize_nearest" :
+									  filter == resize_filter::BOX ? "resize_box" : "resize_bilinear"};
+		harness.run(name, size, pixels, pixels * sizeof(rgb_pixel), [&] {
+			const auto small = resize(p, thumb, filter);
+			if( small.size() != thumb ) { std::abort(); }
+		});
+	}
+
+	if( harness.wanted("transpose")) {
+		auto turned = ppm_image{image_size{size, size}, white};
+		harness.run("transpose", size, pixels, 2 * pixels * sizeof(rgb_pixel), [&] {
+			transpose(p.view(), turned.view());
+		});
+	}
+
+	const auto curve = gamma_lut(2.2);
+	harness.run("lut", size, pixels, 2 * pixels * sizeof(rgb_pixel), [&] { apply_lut(p.view(), curve); });
+
+	harness.run("quantise", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+		const auto indexed = quantise(p.view(), 256, dither::ORDERED);
+		if( indexed.indices.size() != pixels ) { std::abort(); }
+	});
+
+	if( harness.wanted("compare")) {
+		// The same but for the last pixel, so every row is looked at
+		auto other = p;
+		other[size - 1][size - 1].red()++;
+		harness.run("compare", size, pixels, 2 * pixels * sizeof(rgb_pixel), [&] {
+			if( compare_images(p.view(), other.view()).differing != 1 ) { std::abort(); }
+		});
+	}
+
+	harness.run("hash", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+		if( image_hash(p.view()) == 0 ) { std::abort(); }
+	});
+
+	harness.run("stats", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+		const auto stats = measure(p.view(), white);
+		if( stats.pixels != pixels ) { std::abort(); }
+	});
+
+	// In place, so each run blurs the last one's result further, which takes just as long
+	const auto kernel = gaussian_kernel(2.0);
+	harness.run("blur", size, pixels, pixels * sizeof(rgb_pixel), [&] { convolve(p.view(), kernel); });
+
+	for( const auto f: {ppm_image::format::P3, ppm_image::format::P6} ) {
+		const auto name = std::string{f == ppm_image::format::P3 ? "write_p3" : "write_p6"};
+		if( !harness.wanted(name)) { continue; }
+		auto buf = counting_buf{};
+		auto os = std::ostream{&buf};
+		p.write(os, f);
+		const auto bytes = buf.count();
+		harness.run(name, size, pixels, bytes, [&] {
+			auto sink = counting_buf{};
+			auto out = std::ostream{&sink};
+			p.write(out, f);
+		});
+	}
+
+	// Counted by the pixels going in, since what comes out depends on how well they compress
+	harness.run("write_png", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+		auto sink = counting_buf{};
+		auto out = std::ostream{&sink};
+		write_png(out, p.view(), 0);
+	});
+
+	if( harness.wanted("write_qoi") || harness.wanted("read_qoi")) {
+		harness.run("write_qoi", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+			auto sink = counting_buf{};
+			auto out = std::ostream{&sink};
+			write_qoi(out, p.view());
+		});
+		auto encoded = std::stringstream{};
+		write_qoi(encoded, p.view());
+		const auto file = encoded.str();
+		harness.run("read_qoi", size, pixels, pixels * sizeof(rgb_pixel), [&] {
+			auto in = std::istringstream{file};
+			if( read_qoi(in).size() != p.size()) { std::abort(); }
+		});
+	}
+}
+
+void songsim_benchmark(bench_harness &harness, const int words) {
+	if( !harness.wanted("songsim")) { return; }
+	auto opts = corpus_options{};
+	opts.words = static_cast<std::uint64_t>(words);
+	const auto text = make_corpus(opts);
+	const auto pixels = static_cast<std::uint64_t>(words) * words;
+	const auto bytes = pixels * sizeof(rgb_pixel);
+
+	harness.run("songsim", words, pixels, bytes, [&] {
+		auto in = std::istringstream{text};
+		const auto s = read_song(in);
+		const auto p = render_song(s);
+		auto sink = counting_buf{};
+		auto out = std::ostream{&sink};
+		p.write(out, ppm_image::format::P6);
+	});
+}
+
+void usage() {
+	std::cerr << "ppm_bench [--reps N] [--sizes 256,1024] [--words 1000,10000] [--filter name] [--out results.json]\n"
+				 "          [--counters]\n"
+				 "Times the ppm_image operations and writers at each image size, and SongSim from text to P6 at each\n"
+				 "number of words. Results are written as JSON to --out, or stdout, with a summary on stderr.\n"
+				 "--counters also reads the hardware performance counters around each run, where they're allowed.\n";
+}
+
+}
+
+int main(const int argc, const char **argv) {
+	auto reps = 5;
+	auto sizes = std::vector<int>{256, 1024, 2048};
+	auto words = std::vector<int>{1000, 5000, 10000};
+	auto filter = std::string{};
+	auto out = std::string{};
+	auto counters = false;
+
+	for( auto i = 1; i < argc; i++ ) {
+		const auto arg = std::string{argv[i]};
+		if( arg == "--counters" ) {
+			counters = true;
+			continue;
+		}
+		if( arg == "--help" || i + 1 >= argc ) {
+			usage();
+			return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		const auto value = std::string{argv[++i]};
+		try {
+			if( arg == "--reps" ) { reps = std::stoi(value); }
+			else if( arg == "--sizes" ) { sizes = parse_list(value); }
+			else if( arg == "--words" ) { words = parse_list(value); }
+			else if( arg == "--filter" ) { filter = value; }
+			else if( arg == "--out" ) { out = value; }
+			else {
+				usage();
+				return EXIT_FAILURE;
+			}
+		}
+		catch( const std::exception & ) {
+			std::cerr << "Error: bad value " << value << " for " << arg << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto harness = bench_harness{reps, filter, counters};
+	for( const auto size: sizes ) { image_benchmarks(harness, size); }
+	for( const auto w: words ) { songsim_benchmark(harness, w); }
+
+	harness.write_summary(std::cerr);
+	if( out.empty()) {
+		harness.write_json(std::cout);
+	}
+	else {
+		auto file = std::ofstream{out};
+		harness.write_json(file);
+		if( !file ) {
+			std::cerr << "Unable to write " << out << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
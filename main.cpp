@@ -1,23 +1,135 @@
 #include <iostream>
 #include <vector>
-#include <unordered_map>
 #include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
 #include "ppm_file.h"
+#include "song_sim.h"
+#include "batch.h"
+#include "density.h"
+#include "planner.h"
+#include "png.h"
+#include "pyramid.h"
+#include "qoi.h"
+#include "session.h"
+#include "stats.h"
+#include "trace.h"
 #include <tclap/CmdLine.h>
 
+/*!
+ * @brief Render every file in the batch, reporting each as it finishes
+ * @return EXIT_FAILURE if any of the files couldn't be rendered
+ */
+int run_batch_mode(const std::string &source, const batch_options &opts) {
+	auto inputs = std::vector<std::string>{};
+	try {
+		inputs = batch_inputs(source);
+	}
+	catch( const std::exception &e ) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	const auto results = run_batch(inputs, opts, [](const batch_result &r) {
+		if( r.ok ) {
+			std::cout << r.input << " -> " << r.output << " in " << r.seconds << "s\n";
+		}
+		else {
+			std::cerr << r.input << " failed after " << r.seconds << "s: " << r.error << '\n';
+		}
+	});
+
+	const auto failed = std::count_if(results.begin(), results.end(), [](const batch_result &r) { return !r.ok; });
+	std::cout << results.size() - failed << " of " << results.size() << " files written to " << opts.out_dir << std::endl;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+ * @brief Read a size given as "WxH"
+ * @param text The string to read
+ * @param size Set to the size read
+ * @return true if the whole string was a valid size
+ */
+bool parse_size(const std::string &text, image_size &size) {
+	auto in = std::istringstream{text};
+	auto x = char{};
+	return in >> size.width() >> x >> size.height() && x == 'x' && in.peek() == EOF &&
+		   size.width() > 0 && size.height() > 0;
+}
+
+/*!
+ * @brief Write the stats to stderr, if they were asked for
+ * @param format "text", "json" or empty for none
+ */
+void report_stats(const run_stats &stats, const std::string &format) {
+	if(format == "json"){ stats.write_json(std::cerr); }
+	else if(!format.empty()){ stats.write_text(std::cerr); }
+}
+
+/*!
+ * @brief Write the timeline of spans recorded to a file, if it was asked for
+ * @param path Where to write it, or empty for nowhere
+ * @return false if the file couldn't be written
+ */
+bool write_trace(const std::string &path) {
+	if(path.empty()){ return true; }
+	auto out = std::ofstream{path};
+	tracer::write(out);
+	if(!out){
+		std::cerr << "Unable to write the trace to " << path << '\n';
+		return false;
+	}
+	return true;
+}
+
 int main(const int argc, const char **argv) {
 
     constexpr std::string_view whirly {"\\|/-"};
     auto cmd = TCLAP::CmdLine{ "Draws the song lyrics, or basically any words, as a map to show the structure of the words", '=', "0.2" };
-    auto in_arg = TCLAP::ValueArg<std::string>{ "i", "in", "Input filename", true, "default", "string" }; 
-    auto out_arg = TCLAP::ValueArg<std::string>{ "o", "out", "Output filename", false, "default", "string" }; 
-    cmd.add(in_arg);
+    auto in_arg = TCLAP::ValueArg<std::string>{ "i", "in", "Input filename", true, "default", "string" };
+    auto out_arg = TCLAP::ValueArg<std::string>{ "o", "out", "Output filename", false, "default", "string" };
+    auto batch_arg = TCLAP::ValueArg<std::string>{ "b", "batch", "Directory of input files, or a file listing one input filename per line", true, "", "string" };
+    auto out_dir_arg = TCLAP::ValueArg<std::string>{ "d", "out-dir", "Output directory for batch mode", false, ".", "string" };
+    auto jobs_arg = TCLAP::ValueArg<unsigned>{ "j", "jobs", "Number of threads to use, 0 for one per core", false, 0, "unsigned" };
+    auto memory_arg = TCLAP::ValueArg<std::size_t>{ "m", "memory-limit", "Most MiB of images to hold at once in batch mode, or to draw the image with otherwise, 0 for no limit", false, 0, "MiB" };
+    auto max_size_arg = TCLAP::ValueArg<std::string>{ "s", "max-size", "Scale the image down to fit in WxH pixels", false, "", "WxH" };
+    auto aggregate_arg = TCLAP::ValueArg<std::string>{ "a", "aggregate", "How --max-size combines the words in each pixel: count, max or mean", false, "mean", "string" };
+    auto pyramid_arg = TCLAP::ValueArg<std::string>{ "p", "pyramid", "Write a pyramid of tiles for zooming into this directory instead of one image", false, "", "string" };
+    auto tile_arg = TCLAP::ValueArg<int>{ "t", "tile-size", "Width and height of each --pyramid tile", false, 256, "pixels" };
+    auto session_arg = TCLAP::ValueArg<std::string>{ "", "session", "Keep the words read in this file and only draw what's been added to the input since last time, as P6", false, "", "string" };
+    auto stats_arg = TCLAP::ValueArg<std::string>{ "", "stats", "Report the time taken by each phase, throughput and memory use on stderr, --stats=json for JSON", false, "", "text|json" };
+    auto trace_arg = TCLAP::ValueArg<std::string>{ "", "trace", "Write a timeline of what each thread did to this file, to open in chrome://tracing or Perfetto", false, "", "string" };
+    auto hash_arg = TCLAP::ValueArg<std::string>{ "", "hash", "Print a hash of the image's pixels and one of the input and options, --hash=embed also puts the input's in the header as a comment. Not for batch, pyramid or session mode", false, "", "print|embed" };
+    auto strategy_arg = TCLAP::ValueArg<std::string>{ "", "strategy", "How to draw the image: auto picks the fastest that fits in --memory-limit, or dense, rle, sparse or streaming", false, "auto", "string" };
+    auto png_arg = TCLAP::SwitchArg{ "", "png", "Write a PNG instead of a P3 PPM, with --hash=embed's comment as a tEXt chunk. Not for batch, pyramid or session mode", false };
+    auto qoi_arg = TCLAP::SwitchArg{ "", "qoi", "Write a QOI image instead of a P3 PPM, which has no room for --hash=embed's comment. Not for batch, pyramid or session mode", false };
+    cmd.xorAdd(in_arg, batch_arg);
     cmd.add(out_arg);
+    cmd.add(out_dir_arg);
+    cmd.add(jobs_arg);
+    cmd.add(memory_arg);
+    cmd.add(max_size_arg);
+    cmd.add(aggregate_arg);
+    cmd.add(pyramid_arg);
+    cmd.add(tile_arg);
+    cmd.add(session_arg);
+    cmd.add(stats_arg);
+    cmd.add(trace_arg);
+    cmd.add(strategy_arg);
+    cmd.add(hash_arg);
+    cmd.add(png_arg);
+    cmd.add(qoi_arg);
+
+    // --stats on its own means --stats=text, and --hash --hash=print, which the parser can't do by itself
+    auto args = std::vector<const char*>(argv, argv + argc);
+    std::replace_if(args.begin(), args.end(), [](const char* a){ return std::string_view{a} == "--stats"; }, "--stats=text");
+    std::replace_if(args.begin(), args.end(), [](const char* a){ return std::string_view{a} == "--hash"; }, "--hash=print");
 
     auto outfile = std::string{};
     auto infile = std::string{};
     try{
-        cmd.parse(argc, argv);
+        cmd.parse(argc, args.data());
         outfile = out_arg.getValue();
         infile = in_arg.getValue();
     }
@@ -26,7 +138,66 @@ int main(const int argc, const char **argv) {
         return EXIT_FAILURE;
     }
 
-	auto wordmap = std::unordered_map<std::string, std::vector<int>> {};
+	auto max_size = image_size{};
+	if(max_size_arg.isSet() && !parse_size(max_size_arg.getValue(), max_size)){
+		std::cerr << "Error: --max-size must look like 1024x1024\n";
+		return EXIT_FAILURE;
+	}
+	const auto aggregates = std::unordered_map<std::string, aggregate>{
+		{"count", aggregate::COUNT}, {"max", aggregate::MAX}, {"mean", aggregate::MEAN}};
+	if(aggregates.find(aggregate_arg.getValue()) == aggregates.end()){
+		std::cerr << "Error: --aggregate must be one of count, max or mean\n";
+		return EXIT_FAILURE;
+	}
+	const auto stats_format = stats_arg.getValue();
+	if(stats_arg.isSet() && stats_format != "text" && stats_format != "json"){
+		std::cerr << "Error: --stats must be text or json\n";
+		return EXIT_FAILURE;
+	}
+	const auto hash_mode = hash_arg.getValue();
+	if(hash_arg.isSet() && hash_mode != "print" && hash_mode != "embed"){
+		std::cerr << "Error: --hash must be print or embed\n";
+		return EXIT_FAILURE;
+	}
+	if(png_arg.getValue() && qoi_arg.getValue()){
+		std::cerr << "Error: only one of --png and --qoi can be given\n";
+		return EXIT_FAILURE;
+	}
+	auto forced = strategy::AUTO;
+	if(!parse_strategy(strategy_arg.getValue(), forced)){
+		std::cerr << "Error: --strategy must be one of auto, dense, rle, sparse or streaming\n";
+		return EXIT_FAILURE;
+	}
+	auto stats = run_stats{};
+	const auto trace_path = trace_arg.getValue();
+	if(!trace_path.empty()){ tracer::enable(); }
+
+	if(batch_arg.isSet()){
+		auto opts = batch_options{};
+		opts.out_dir = out_dir_arg.getValue();
+		opts.jobs = jobs_arg.getValue();
+		opts.memory_limit = memory_arg.getValue() * 1024 * 1024;
+		const auto result = run_batch_mode(batch_arg.getValue(), opts);
+		return write_trace(trace_path) ? result : EXIT_FAILURE;
+	}
+
+	if(session_arg.isSet()){
+		try{
+			const auto update = stats.time("session", [&]{ return update_session(session_arg.getValue(), infile, outfile + ".ppm"); });
+			stats.tokens = static_cast<std::uint64_t>(update.words - update.old_words);
+			stats.pixels = update.cells_written;
+			std::cout << (update.old_words == 0 ? "Drew " : update.redrawn ? "Redrew " : "Updated ")
+					  << update.words - update.old_words << " new words, " << update.words << " in total, drawing "
+					  << update.cells_written << " cells in " << outfile << ".ppm" << std::endl;
+			report_stats(stats, stats_format);
+		}
+		catch(const std::exception& e){
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		return write_trace(trace_path) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
     auto file = std::fstream{infile, std::fstream::in};
 
 	if(!file.is_open()){
@@ -34,87 +205,110 @@ int main(const int argc, const char **argv) {
 		return EXIT_FAILURE;
 	}
 
-	auto word = std::string{};
-	auto word_num = 0;
-
-	/*
-	 * The maximum number of occurrences of any word will be used later of evenly distributing the colour values.
-	 * So the word with the most occurences will be bluer. Must start at one to prevent a divide by 0 error if only one word.
-	 */
-	auto max_occurrences = std::vector<int>::size_type{1};
-
-	while(file >> word){
-
-		word.erase (std::remove_if (word.begin (), word.end (), ispunct), word.end ());
-		std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+	auto text = stats.time("read", [&]{ return read_text(file); });
+	file.close();
+	// Only what changes the pixels, so the same text drawn with another strategy or memory limit matches
+	const auto options = max_size_arg.isSet() ? "max-size=" + max_size_arg.getValue() + " aggregate=" + aggregate_arg.getValue() : std::string{};
+	const auto input = hash_arg.isSet() ? input_hash(text, options) : 0;
+	const auto comment = hash_mode == "embed" ? "songsim input " + hash_hex(input) : std::string{};
+	auto lyrics = song{};
+	{
+		const auto words = stats.time("tokenize", [&]{ return tokenise(text); });
+		stats.time("index", [&]{ index_words(lyrics, words); });
+	}
+	text = std::string{};
+	stats.tokens = static_cast<std::uint64_t>(lyrics.word_num);
+	stats.distinct_words = lyrics.wordmap.size();
 
-		if(wordmap.find(word) != wordmap.end()){
-			wordmap[word].push_back(word_num);
-			if(wordmap[word].size() > max_occurrences){ max_occurrences = static_cast<int>(wordmap[word].size()); }
+	if(pyramid_arg.isSet()){
+		auto opts = pyramid_options{};
+		opts.out_dir = pyramid_arg.getValue();
+		opts.tile_size = tile_arg.getValue();
+		opts.mode = aggregates.at(aggregate_arg.getValue());
+		opts.threads = jobs_arg.getValue();
+		try{
+			const auto tiles = stats.time("pyramid", [&]{ return write_pyramid(lyrics, opts); });
+			std::cout << tiles << " tiles written to " << opts.out_dir << std::endl;
+			report_stats(stats, stats_format);
 		}
-		else{
-			// if the first occurrence make a new vector
-			wordmap[word].emplace_back(word_num);
+		catch(const std::exception& e){
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
 		}
-		word_num++;
+		return write_trace(trace_path) ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
-	file.close();
 
+	// Display something on the screen so the user knows something's happening.
+	auto i = std::size_t{0};
+	const auto tick = [&]{ std::cout << "\r" << whirly[i++ % whirly.length()]; };
 	auto p = ppm_image{};
-
-	// Create background of image totally white
-	for(int w = 0; w < word_num; w++){
-		p << std::vector<rgb_pixel>(word_num, rgb_pixel::get_colour(rgb_pixel::colours::WHITE));
-	}
-
-	
-	// k is the multiplier for the values, so that the word with the most occurrences is the bluest
-	const auto k = std::numeric_limits<uint8_t>::max()/max_occurrences;
-
-	// Create the image by changing values in the grid
-	int i = 0;
-	for(const auto& unique_word : wordmap){
-		auto vect_idx_x = 0;
-
-		// Each word has a number of indices, so loop over the indices and use each
-		// as an x and as a y value to make the grid.
-		for(const auto& x: unique_word.second){
-			// Increment this before use to prevent having a multiplier of 0
-			vect_idx_x++;
-			auto vect_idx_y = 0;
-			for(const auto& y: unique_word.second) {
-				// Increment this before use to prevent having a multiplier of 0
-				vect_idx_y++;
-
-				// These colours values are fairly random:
-				// make there more red when the x index increases
-				// make there more blue when the y index increases
-				// make the blue more intense based on how many occurrences of this word
-                const auto r = vect_idx_x * k;
-                const auto g = vect_idx_y * k;
-                const auto b = unique_word.second.size() * k;
-				const auto pix = rgb_pixel{static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b)};
-
-				// Display something on the screen so the user knows something's happening.
-				std::cout << "\r" << whirly[i++ % whirly.length() - 1];
-				p[x][y] = pix;
-			}
-
+	auto plan = render_plan{};
+	if(max_size_arg.isSet()){
+		p = stats.time("render", [&]{ return render_density(lyrics, max_size, aggregates.at(aggregate_arg.getValue()), jobs_arg.getValue()); });
+		stats.pixels = static_cast<std::uint64_t>(p.size().width()) * p.size().height();
+	}
+	else{
+		try{
+			plan = stats.time("plan", [&]{ return plan_render(lyrics, memory_arg.getValue() * 1024 * 1024, jobs_arg.getValue(), forced); });
+		}
+		catch(const std::exception& e){
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		stats.strategy = strategy_name(plan.chosen);
+		stats.planned_bytes = plan.chosen_estimate().bytes;
+		stats.pixels = static_cast<std::uint64_t>(lyrics.word_num) * static_cast<std::uint64_t>(lyrics.word_num);
+		// The other strategies draw the image as it's written
+		if(plan.chosen == strategy::DENSE){
+			p = stats.time("background", [&]{ return blank_image(lyrics); });
+			stats.time("colour", [&]{ colour_song(lyrics, p, jobs_arg.getValue(), tick); });
 		}
 	}
 
-	std::cout << "\r";
-
 	// Finally write the file out
-	file.open(outfile + ".ppm", std::fstream::out);
+	const auto binary = png_arg.getValue() || qoi_arg.getValue();
+	const auto extension = std::string{png_arg.getValue() ? ".png" : qoi_arg.getValue() ? ".qoi" : ".ppm"};
+	file.open(outfile + extension, binary ? std::fstream::out | std::fstream::binary : std::fstream::out);
 	if(!file.is_open()){
 		std::cerr << "Unable to open " << outfile << '\n';
 		return EXIT_FAILURE;
 	}
-	file << p;
+	auto pixels = std::uint64_t{0};
+	try{
+		if(max_size_arg.isSet() || plan.chosen == strategy::DENSE){
+			stats.time("write", [&]{
+				if(png_arg.getValue()){
+					auto writer = png_writer{file, p.size(), jobs_arg.getValue(), 6, comment};
+					for(auto row = 0; row < p.size().height(); row++){ writer.write_row(p[row]); }
+					pixels = writer.pixel_hash();
+				}
+				else if(qoi_arg.getValue()){ pixels = write_qoi(file, p.view()); }
+				else{ pixels = p.write(file, ppm_image::format::P3, comment); }
+				file.flush();
+			});
+		}
+		else{
+			stats.time("stream", [&]{
+				if(png_arg.getValue()){ pixels = write_song_png(lyrics, plan, file, jobs_arg.getValue(), tick, comment); }
+				else if(qoi_arg.getValue()){ pixels = write_song_qoi(lyrics, plan, file, jobs_arg.getValue(), tick); }
+				else{ pixels = write_song(lyrics, plan, file, ppm_image::format::P3, jobs_arg.getValue(), tick, comment); }
+				file.flush();
+			});
+		}
+	}
+	catch(const std::exception& e){
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+	stats.bytes_written = static_cast<std::uint64_t>(file.tellp());
 	file.close();
 
-	std::cout << "Result written to " << outfile << ".ppm" << std::endl;
+	std::cout << "\r";
+	std::cout << "Result written to " << outfile << extension << std::endl;
+	if(hash_arg.isSet()){
+		std::cout << "Pixels hash " << hash_hex(pixels) << "\nInput hash " << hash_hex(input) << std::endl;
+	}
+	report_stats(stats, stats_format);
 
-	return EXIT_SUCCESS;
+	return write_trace(trace_path) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
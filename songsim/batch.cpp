@@ -0,0 +1,182 @@
+#include "batch.h"
+#include "song_sim.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/*!
+ * @brief Keeps the total size of images being held at once below a limit
+ */
+class memory_budget {
+public:
+	explicit memory_budget(const std::size_t limit)
+			: _limit(limit)
+	{ /*! Intentionally Blank */ }
+
+	/*!
+	 * @brief Wait until there's room for the bytes
+	 * @param bytes The amount to reserve
+	 * @throw std::runtime_error if the bytes would never fit
+	 */
+	void acquire(const std::size_t bytes) {
+		if( _limit == 0 ) { return; }
+		if( bytes > _limit ) {
+			throw std::runtime_error("Needs " + std::to_string(bytes >> 20) + " MiB, more than the memory limit");
+		}
+		auto lock = std::unique_lock<std::mutex>{_mutex};
+		_freed.wait(lock, [&] { return _in_use + bytes <= _limit; });
+		_in_use += bytes;
+	}
+
+	/*!
+	 * @brief Give back a reservation made by acquire
+	 * @param bytes The amount that was reserved
+	 */
+	void release(const std::size_t bytes) {
+		if( _limit == 0 ) { return; }
+		{
+			auto lock = std::lock_guard<std::mutex>{_mutex};
+			_in_use -= bytes;
+		}
+		_freed.notify_all();
+	}
+
+private:
+	const std::size_t 		_limit;
+	std::size_t 			_in_use{0};
+	std::mutex 				_mutex;
+	std::condition_variable _freed;
+};
+
+/*!
+ * @brief Render one file, throwing if anything goes wrong
+ */
+void render_one(batch_result &result, memory_budget &budget) {
+	auto in = std::ifstream{result.input};
+	if( !in.is_open()) { throw std::runtime_error("Unable to open " + result.input); }
+	const auto s = [&] {
+		const auto span = trace_span{"read"};
+		return read_song(in);
+	}();
+	in.close();
+
+	const auto bytes = render_bytes(s);
+	budget.acquire(bytes);
+	try {
+		// Each worker is already a thread of its own, so render single threaded
+		const auto p = render_song(s, 1);
+		const auto span = trace_span{"write"};
+		auto out = std::ofstream{result.output};
+		if( !out.is_open()) { throw std::runtime_error("Unable to open " + result.output); }
+		out << p;
+		if( !out ) { throw std::runtime_error("Unable to write " + result.output); }
+	}
+	catch( ... ) {
+		budget.release(bytes);
+		throw;
+	}
+	budget.release(bytes);
+}
+
+}
+
+std::vector<std::string> batch_inputs(const std::string &source) {
+	auto inputs = std::vector<std::string>{};
+	if( fs::is_directory(source)) {
+		for( const auto &entry: fs::directory_iterator{source} ) {
+			if( entry.is_regular_file()) { inputs.push_back(entry.path().string()); }
+		}
+		std::sort(inputs.begin(), inputs.end());
+		return inputs;
+	}
+
+	auto list = std::ifstream{source};
+	if( !list.is_open()) { throw std::runtime_error("Unable to open " + source); }
+	auto line = std::string{};
+	while( std::getline(list, line)) {
+		if( !line.empty()) { inputs.push_back(line); }
+	}
+	return inputs;
+}
+
+std::vector<std::string> batch_outputs(const std::vector<std::string> &inputs, const std::string &out_dir) {
+	auto names = std::vector<std::string>{};
+	for( const auto &input: inputs ) { names.push_back(fs::path{input}.stem().string()); }
+
+	// Every plain name is taken first, so a file that's really called song-2 keeps its name
+	auto taken = std::set<std::string>{names.begin(), names.end()};
+	auto seen = std::set<std::string>{};
+	auto outputs = std::vector<std::string>{};
+	for( const auto &name: names ) {
+		auto unique = name;
+		if( !seen.insert(name).second ) {
+			auto n = 1;
+			do { unique = name + "-" + std::to_string(++n); } while( !taken.insert(unique).second );
+		}
+		outputs.push_back((fs::path{out_dir} / unique).string() + ".ppm");
+	}
+	return outputs;
+}
+
+std::vector<batch_result> run_batch(const std::vector<std::string> &inputs, const batch_options &opts,
+									const std::function<void(const batch_result &)> &done) {
+	auto results = std::vector<batch_result>(inputs.size());
+	const auto outputs = batch_outputs(inputs, opts.out_dir);
+	for( std::size_t i = 0; i < inputs.size(); i++ ) {
+		results[i].input = inputs[i];
+		results[i].output = outputs[i];
+	}
+
+	// Biggest first, files that can't be sized go last and will most likely fail to open anyway
+	auto order = std::vector<std::size_t>(inputs.size());
+	std::iota(order.begin(), order.end(), 0);
+	auto sizes = std::vector<std::uintmax_t>(inputs.size(), 0);
+	for( std::size_t i = 0; i < inputs.size(); i++ ) {
+		auto ec = std::error_code{};
+		const auto size = fs::file_size(inputs[i], ec);
+		sizes[i] = ec ? 0 : size;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) {
+		return sizes[a] > sizes[b];
+	});
+
+	auto budget = memory_budget{opts.memory_limit};
+	auto done_mutex = std::mutex{};
+
+	parallel_jobs(order.size(), opts.jobs, [&](const std::size_t job) {
+		auto &result = results[order[job]];
+		const auto span = trace_span{"file", static_cast<int>(order[job])};
+
+		const auto start = std::chrono::steady_clock::now();
+		try {
+			render_one(result, budget);
+			result.ok = true;
+		}
+		catch( const std::bad_alloc & ) {
+			result.error = "Out of memory";
+		}
+		catch( const std::exception &e ) {
+			result.error = e.what();
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if( done ) {
+			auto lock = std::lock_guard<std::mutex>{done_mutex};
+			done(result);
+		}
+	});
+
+	return results;
+}
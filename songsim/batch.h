@@ -0,0 +1,65 @@
+#ifndef SONGSIM_BATCH_H
+#define SONGSIM_BATCH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/*!
+ * @brief How to run a batch of renders
+ */
+struct batch_options {
+	/*! The directory the images are written to, named as batch_outputs says */
+	std::string out_dir{"."};
+	/*! How many files to render at once, 0 means one per hardware thread */
+	unsigned jobs{0};
+	/*!
+	 * The most bytes of image data allowed in memory at once, 0 for no limit.
+	 * A file which needs more than this on its own fails rather than being rendered.
+	 */
+	std::size_t memory_limit{0};
+};
+
+/*!
+ * @brief What happened to one file in the batch
+ */
+struct batch_result {
+	std::string input;	/*! The file that was read 						*/
+	std::string output;	/*! Where the image was to be written			*/
+	double seconds{0};	/*! How long it took, including waiting for memory */
+	bool ok{false};		/*! Whether the image was written 				*/
+	std::string error;	/*! Why not, if it wasn't 						*/
+};
+
+/*!
+ * @brief Find the files to render
+ * @param source Either a directory, in which case every regular file in it is used,
+ * or a file listing one input filename per line
+ * @return The input filenames
+ * @throw std::runtime_error if the source can't be read
+ */
+std::vector<std::string> batch_inputs(const std::string& source);
+
+/*!
+ * @brief Where each input's image is written, named after the input file without its directory or extension.
+ * Inputs with the same name in different directories would overwrite each other, so the first keeps the name
+ * and the rest have -2, -3 and so on added, skipping any that another input is already called.
+ * @param inputs The files to render
+ * @param out_dir The directory the images are written to
+ * @return The output filename of each input, in the order they were given
+ */
+std::vector<std::string> batch_outputs(const std::vector<std::string>& inputs, const std::string& out_dir);
+
+/*!
+ * @brief Render every input file to a .ppm in the output directory using a pool of workers.
+ * The biggest files are started first so that a large file doesn't end up running on its own at the end.
+ * A file failing doesn't stop the rest of the batch.
+ * @param inputs The files to render
+ * @param opts How to run the batch
+ * @param done Called from the worker thread as each file finishes, calls are never concurrent
+ * @return The result for each input, in the order they were given
+ */
+std::vector<batch_result> run_batch(const std::vector<std::string>& inputs, const batch_options& opts,
+									const std::function<void(const batch_result&)>& done = {});
+
+#endif //SONGSIM_BATCH_H
@@ -0,0 +1,120 @@
+#ifndef SONGSIM_BLOCKS_H
+#define SONGSIM_BLOCKS_H
+
+#include "density.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * The pieces shared by everything which draws the song scaled down straight from the word positions,
+ * rather than by shrinking a full size image.
+ */
+
+/*!
+ * @brief A run of consecutive occurrences of one word which all fall in the same block
+ */
+struct block_run {
+	int 		block;		/*! The output row or column 							*/
+	std::size_t count;		/*! How many occurrences 								*/
+	std::size_t first_idx;	/*! The 1 based occurrence number of the first of them 	*/
+	std::size_t last_idx;	/*! The 1 based occurrence number of the last of them 	*/
+};
+
+/*!
+ * @brief The running totals for one output pixel
+ */
+struct block_totals {
+	std::uint64_t 	count{0};
+	std::uint64_t 	r{0};
+	std::uint64_t 	g{0};
+	std::uint64_t 	b{0};
+};
+
+/*!
+ * @brief Maps the word numbers [first, first + in) onto out blocks, as evenly as possible
+ */
+struct block_axis {
+	int first;
+	int in;
+	int out;
+
+	/*!
+	 * @brief The block a word number falls in
+	 */
+	int block(const int pos) const {
+		return static_cast<int>(static_cast<long long>(pos - first) * out / in);
+	}
+
+	/*!
+	 * @brief The first word number which falls in the block, the inverse of block()
+	 */
+	int start(const int b) const {
+		return first + static_cast<int>((static_cast<long long>(b) * in + out - 1) / out);
+	}
+};
+
+/*!
+ * @brief Group the occurrences in [begin, end) into runs that fall into the same block
+ * @param indices All the occurrences of the word, used to work out the occurrence numbers
+ */
+inline void make_runs(const std::vector<int> &indices, std::vector<int>::const_iterator begin,
+					  const std::vector<int>::const_iterator end, const block_axis &axis, std::vector<block_run> &runs) {
+	runs.clear();
+	for( ; begin != end; ++begin ) {
+		const auto block = axis.block(*begin);
+		const auto idx = static_cast<std::size_t>(begin - indices.begin()) + 1;
+		if( runs.empty() || runs.back().block != block ) {
+			runs.push_back(block_run{block, 1, idx, idx});
+		}
+		else {
+			runs.back().count++;
+			runs.back().last_idx = idx;
+		}
+	}
+}
+
+/*!
+ * @brief Add every cell where an x run crosses a y run of the same word to the totals
+ * @param k The colour multiplier for the song
+ * @param b The blue value for the word, which only depends on how often it occurs
+ */
+inline void accumulate(block_totals &t, const block_run &xr, const block_run &yr, const std::uint64_t k,
+					   const std::uint64_t b, const aggregate mode) {
+	const auto cells = static_cast<std::uint64_t>(xr.count) * yr.count;
+	t.count += cells;
+	if( mode == aggregate::MEAN ) {
+		// Red goes up with the x occurrence and green with the y occurrence, the sum of a run's occurrences is arithmetic
+		t.r += static_cast<std::uint64_t>(xr.first_idx + xr.last_idx) * xr.count / 2 * k * yr.count;
+		t.g += static_cast<std::uint64_t>(yr.first_idx + yr.last_idx) * yr.count / 2 * k * xr.count;
+		t.b += b * cells;
+	}
+	else if( mode == aggregate::MAX ) {
+		t.r = std::max<std::uint64_t>(t.r, xr.last_idx * k);
+		t.g = std::max<std::uint64_t>(t.g, yr.last_idx * k);
+		t.b = std::max<std::uint64_t>(t.b, b);
+	}
+}
+
+/*!
+ * @brief The colour of a block which has at least one matching cell
+ * @param cells How many cells of the full size grid are in the block
+ */
+inline rgb_pixel block_colour(const block_totals &t, const aggregate mode, const double cells) {
+	switch( mode ) {
+		case aggregate::COUNT: {
+			const auto shade = 255.0 * (1.0 - std::log1p(static_cast<double>(t.count)) / std::log1p(cells));
+			const auto v = static_cast<uint8_t>(std::lround(shade));
+			return rgb_pixel{v, v, v};
+		}
+		case aggregate::MAX:
+			return rgb_pixel{static_cast<uint8_t>(t.r), static_cast<uint8_t>(t.g), static_cast<uint8_t>(t.b)};
+		case aggregate::MEAN:
+		default:
+			return rgb_pixel{static_cast<uint8_t>(t.r / t.count), static_cast<uint8_t>(t.g / t.count),
+							 static_cast<uint8_t>(t.b / t.count)};
+	}
+}
+
+#endif //SONGSIM_BLOCKS_H
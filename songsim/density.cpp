@@ -0,0 +1,69 @@
+#include "density.h"
+#include "blocks.h"
+#include "parallel.h"
+#include "trace.h"
+#include <limits>
+
+ppm_image render_density(const song &s, const image_size &max_size, const aggregate mode, const unsigned threads) {
+	const auto n = s.word_num;
+	// Rows of the grid are the x word, columns the y word
+	const auto out_w = std::max(0, std::min(max_size.width(), n));
+	const auto out_h = std::max(0, std::min(max_size.height(), n));
+	auto p = ppm_image{image_size{out_w, out_h}, rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+	if( out_w == 0 || out_h == 0 ) { return p; }
+
+	const auto k = std::numeric_limits<uint8_t>::max() / s.max_occurrences;
+	const auto rows = block_axis{0, n, out_h};
+	const auto cols = block_axis{0, n, out_w};
+
+	// The column runs of each word are the same for every band, so only work them out once
+	auto words = std::vector<const std::vector<int> *>{};
+	auto column_runs = std::vector<std::vector<block_run>>{};
+	for( const auto &unique_word: s.wordmap ) {
+		words.push_back(&unique_word.second);
+		column_runs.emplace_back();
+		make_runs(unique_word.second, unique_word.second.begin(), unique_word.second.end(), cols, column_runs.back());
+	}
+
+	// Output rows are worked out a chunk at a time to keep the totals small for huge outputs
+	constexpr auto chunk_rows = 64;
+	parallel_bands(out_h, threads, [&](const int first, const int last, const int band) {
+		const auto span = trace_span{"render band", band};
+		auto totals = std::vector<block_totals>{};
+		auto row_runs = std::vector<block_run>{};
+
+		for( auto chunk = first; chunk < last; chunk += chunk_rows ) {
+			const auto chunk_end = std::min(chunk + chunk_rows, last);
+			totals.assign(static_cast<std::size_t>(chunk_end - chunk) * out_w, block_totals{});
+
+			for( std::size_t w = 0; w < words.size(); w++ ) {
+				const auto &indices = *words[w];
+				const auto begin = std::lower_bound(indices.begin(), indices.end(), rows.start(chunk));
+				const auto end = std::lower_bound(begin, indices.end(), rows.start(chunk_end));
+				if( begin == end ) { continue; }
+				make_runs(indices, begin, end, rows, row_runs);
+
+				const auto b = static_cast<std::uint64_t>(indices.size() * k);
+				for( const auto &xr: row_runs ) {
+					auto *row = &totals[static_cast<std::size_t>(xr.block - chunk) * out_w];
+					for( const auto &yr: column_runs[w] ) {
+						accumulate(row[yr.block], xr, yr, k, b, mode);
+					}
+				}
+			}
+
+			for( auto row = chunk; row < chunk_end; row++ ) {
+				const auto rows_in_block = rows.start(row + 1) - rows.start(row);
+				auto line = p[row];
+				for( auto col = 0; col < out_w; col++ ) {
+					const auto &t = totals[static_cast<std::size_t>(row - chunk) * out_w + col];
+					if( t.count == 0 ) { continue; }
+					const auto cells = static_cast<double>(rows_in_block) * (cols.start(col + 1) - cols.start(col));
+					line[col] = block_colour(t, mode, cells);
+				}
+			}
+		}
+	});
+
+	return p;
+}
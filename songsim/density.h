@@ -0,0 +1,26 @@
+#ifndef SONGSIM_DENSITY_H
+#define SONGSIM_DENSITY_H
+
+#include "song_sim.h"
+
+/*!
+ * @brief How the cells of the full size grid which fall in one output pixel are combined
+ */
+enum class aggregate {
+	COUNT, 	/*! Darker the more cells in the block match, on a log scale */
+	MAX,	/*! The brightest value of each channel out of the matching cells */
+	MEAN	/*! The average colour of the matching cells */
+};
+
+/*!
+ * @brief Draw the song scaled down to fit in a fixed size, without ever holding the full size grid.
+ * The time taken depends on how many words match and the size of the output, not on word_num squared.
+ * @param s The song to draw
+ * @param max_size The largest the image may be, it's smaller if the song has fewer words than this
+ * @param mode How the cells in each block are combined, blocks with no matching cells are white
+ * @param threads How many threads to draw with, 0 means one per hardware thread
+ * @return The image
+ */
+ppm_image render_density(const song& s, const image_size& max_size, aggregate mode, unsigned threads = 1);
+
+#endif //SONGSIM_DENSITY_H
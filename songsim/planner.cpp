@@ -0,0 +1,233 @@
+#include "planner.h"
+#include "draw.h"
+#include "parallel.h"
+#include "png.h"
+#include "qoi.h"
+#include "trace.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+/*
+ * Rough costs in nanoseconds, they only need to rank the strategies the right way round
+ */
+constexpr auto fill_ns = 0.5;		/*! Setting a pixel to white 									*/
+constexpr auto cell_ns = 2.0;		/*! Colouring a matching cell, which is a scattered write 		*/
+constexpr auto index_ns = 3.0;		/*! Recording the word at one row 								*/
+constexpr auto lookup_ns = 40.0;	/*! Finding the occurrences of one word in a chunk of rows 		*/
+constexpr auto split_ns = 4.0;		/*! Splitting the run a matching cell is in 					*/
+
+/*! Rows streamed at a time when there's no memory limit to fit in */
+constexpr auto default_chunk_rows = 1024;
+
+/*!
+ * @brief The occurrences of the word at each row, and where in them the row is
+ */
+struct row_index {
+	std::vector<const std::vector<int> *> occurrences;
+	std::vector<int> rank;
+};
+
+constexpr auto row_index_bytes = sizeof(const std::vector<int> *) + sizeof(int);
+
+row_index index_rows(const song &s) {
+	auto index = row_index{};
+	index.occurrences.resize(static_cast<std::size_t>(s.word_num));
+	index.rank.resize(static_cast<std::size_t>(s.word_num));
+	for( const auto &word: s.wordmap ) {
+		const auto &indices = word.second;
+		for( std::size_t i = 0; i < indices.size(); i++ ) {
+			index.occurrences[indices[i]] = &indices;
+			index.rank[indices[i]] = static_cast<int>(i);
+		}
+	}
+	return index;
+}
+
+/*!
+ * @brief The colour render_song gives a matching cell
+ * @param k The colour multiplier
+ * @param rank_x Where the row is in the word's occurrences
+ * @param rank_y Where the column is in the word's occurrences
+ * @param count How many occurrences the word has
+ */
+rgb_pixel cell_colour(const std::size_t k, const std::size_t rank_x, const std::size_t rank_y, const std::size_t count) {
+	return rgb_pixel{static_cast<uint8_t>((rank_x + 1) * k), static_cast<uint8_t>((rank_y + 1) * k),
+					 static_cast<uint8_t>(count * k)};
+}
+
+std::size_t colour_multiplier(const song &s) {
+	return std::numeric_limits<uint8_t>::max() / s.max_occurrences;
+}
+
+template<typename Writer>
+void write_sparse(const song &s, Writer &writer, const std::function<void()> &tick) {
+	const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+	const auto k = colour_multiplier(s);
+	const auto index = index_rows(s);
+	auto line = ppm_image{image_size{s.word_num, 1}, white};
+	for( auto x = 0; x < s.word_num; x++ ) {
+		fill(line.view(), white);
+		const auto &indices = *index.occurrences[x];
+		for( std::size_t y = 0; y < indices.size(); y++ ) {
+			line[0][indices[y]] = cell_colour(k, index.rank[x], y, indices.size());
+		}
+		writer.write_row(line[0]);
+		if( tick && x % 4096 == 0 ) { tick(); }
+	}
+}
+
+template<typename Writer>
+void write_streaming(const song &s, const int chunk_rows, Writer &writer, const unsigned threads,
+					 const std::function<void()> &tick) {
+	const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+	auto chunk = ppm_image{image_size{s.word_num, std::min(chunk_rows, s.word_num)}, white};
+	for( auto first = 0; first < s.word_num; first += chunk_rows ) {
+		const auto rows = std::min(chunk_rows, s.word_num - first);
+		parallel_bands(rows, threads, [&](const int band_first, const int band_last, const int band) {
+			const auto span = trace_span{"render band", band};
+			fill_rect(chunk.view(), {0, band_first, s.word_num, band_last - band_first}, white);
+			colour_rows(s, chunk, first + band_first, first + band_last, first);
+		});
+		for( auto row = 0; row < rows; row++ ) {
+			writer.write_row(chunk[row]);
+		}
+		if( tick ) { tick(); }
+	}
+}
+
+/*!
+ * @brief Draw the rows a streaming plan draws and hand them to the writer in order
+ */
+template<typename Writer>
+void write_rows(const song &s, const render_plan &plan, Writer &writer, const unsigned threads,
+				const std::function<void()> &tick) {
+	switch( plan.chosen ) {
+		case strategy::RLE: render_song_rle(s, threads, tick).write_to(writer); break;
+		case strategy::SPARSE: write_sparse(s, writer, tick); break;
+		default: write_streaming(s, plan.chunk_rows, writer, threads, tick); break;
+	}
+}
+
+/*!
+ * @brief Draw the song following the plan, for writers which only take rows
+ * @return The writer's hash of the pixels
+ */
+template<typename Writer>
+std::uint64_t write_with(const song &s, const render_plan &plan, Writer &writer, const unsigned threads,
+						 const std::function<void()> &tick) {
+	if( plan.chosen == strategy::DENSE || plan.chosen == strategy::AUTO ) {
+		const auto image = render_song(s, threads, tick);
+		for( auto row = 0; row < image.size().height(); row++ ) { writer.write_row(image[row]); }
+	}
+	else {
+		write_rows(s, plan, writer, threads, tick);
+	}
+	return writer.pixel_hash();
+}
+
+}
+
+const strategy_estimate &render_plan::chosen_estimate() const {
+	return estimates.at(static_cast<std::size_t>(chosen) - 1);
+}
+
+std::string strategy_name(const strategy s) {
+	switch( s ) {
+		case strategy::AUTO: return "auto";
+		case strategy::DENSE: return "dense";
+		case strategy::RLE: return "rle";
+		case strategy::SPARSE: return "sparse";
+		case strategy::STREAMING: return "streaming";
+	}
+	return "unknown";
+}
+
+bool parse_strategy(const std::string &name, strategy &s) {
+	for( const auto candidate: {strategy::AUTO, strategy::DENSE, strategy::RLE, strategy::SPARSE, strategy::STREAMING} ) {
+		if( strategy_name(candidate) == name ) {
+			s = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+render_plan plan_render(const song &s, const std::uint64_t memory_limit, unsigned threads, const strategy forced) {
+	if( threads == 0 ) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+	const auto n = static_cast<std::uint64_t>(s.word_num);
+	const auto cells = static_cast<double>(n) * static_cast<double>(n);
+	const auto row_bytes = n * sizeof(rgb_pixel);
+	const auto parallel = static_cast<double>(std::min<std::uint64_t>(threads, std::max<std::uint64_t>(n, 1)));
+
+	auto plan = render_plan{};
+	for( const auto &word: s.wordmap ) {
+		plan.matches += static_cast<std::uint64_t>(word.second.size()) * word.second.size();
+	}
+	const auto matches = static_cast<double>(plan.matches);
+
+	// Stream as many rows at a time as fit, fewer chunks means fewer passes over the word map
+	const auto chunk_bytes = row_bytes + sizeof(int);
+	const auto fitting_rows = memory_limit == 0 ? default_chunk_rows : memory_limit / std::max<std::uint64_t>(chunk_bytes, 1);
+	plan.chunk_rows = static_cast<int>(std::clamp<std::uint64_t>(fitting_rows, 1, std::max<std::uint64_t>(n, 1)));
+	const auto chunks = static_cast<double>(n == 0 ? 0 : (n + plan.chunk_rows - 1) / plan.chunk_rows);
+
+	const auto add = [&](const strategy kind, const std::uint64_t bytes, const double ns) {
+		plan.estimates.push_back(strategy_estimate{kind, bytes, ns / 1e9, memory_limit == 0 || bytes <= memory_limit});
+	};
+	add(strategy::DENSE, render_bytes(s), (cells * fill_ns + matches * cell_ns) / parallel);
+	// Every matching cell splits a white run in two at worst, and rows are expanded to write them
+	add(strategy::RLE, n * sizeof(rle_image::row_type) + (n + 2 * plan.matches) * sizeof(rle_image::run) + row_bytes,
+		matches * (cell_ns + split_ns) / parallel + cells * fill_ns);
+	add(strategy::SPARSE, n * row_index_bytes + row_bytes,
+		static_cast<double>(n) * index_ns + cells * fill_ns + matches * cell_ns);
+	add(strategy::STREAMING, static_cast<std::uint64_t>(plan.chunk_rows) * chunk_bytes,
+		chunks * static_cast<double>(s.wordmap.size()) * lookup_ns + (cells * fill_ns + matches * cell_ns) / parallel);
+
+	if( forced != strategy::AUTO ) {
+		plan.chosen = forced;
+		return plan;
+	}
+
+	const auto best = std::min_element(plan.estimates.begin(), plan.estimates.end(),
+									   [](const strategy_estimate &a, const strategy_estimate &b) {
+										   return a.fits != b.fits ? a.fits : a.seconds < b.seconds;
+									   });
+	if( !best->fits ) {
+		throw std::runtime_error("Drawing " + std::to_string(n) + " words needs at least " +
+								 std::to_string(plan.estimates.back().bytes) + " bytes, more than the memory limit of " +
+								 std::to_string(memory_limit));
+	}
+	plan.chosen = best->kind;
+	return plan;
+}
+
+std::uint64_t write_song(const song &s, const render_plan &plan, std::ostream &os, const ppm_image::format f,
+						 const unsigned threads, const std::function<void()> &tick, const std::string &comment) {
+	if( plan.chosen == strategy::DENSE || plan.chosen == strategy::AUTO ) {
+		return render_song(s, threads, tick).write(os, f, comment);
+	}
+
+	// Every cell is white unless it's coloured, so the max colour is always the most there can be
+	auto writer = ppm_writer{os, image_size{s.word_num, s.word_num}, std::numeric_limits<uint8_t>::max(), f, comment};
+	if( s.word_num == 0 ) { return writer.pixel_hash(); }
+	write_rows(s, plan, writer, threads, tick);
+	return writer.pixel_hash();
+}
+
+std::uint64_t write_song_png(const song &s, const render_plan &plan, std::ostream &os, const unsigned threads,
+							 const std::function<void()> &tick, const std::string &comment) {
+	if( s.word_num == 0 ) { throw std::runtime_error("There are no words to draw a PNG of"); }
+	auto writer = png_writer{os, image_size{s.word_num, s.word_num}, threads, 6, comment};
+	return write_with(s, plan, writer, threads, tick);
+}
+
+std::uint64_t write_song_qoi(const song &s, const render_plan &plan, std::ostream &os, const unsigned threads,
+							 const std::function<void()> &tick) {
+	if( s.word_num == 0 ) { throw std::runtime_error("There are no words to draw a QOI image of"); }
+	auto writer = qoi_writer{os, image_size{s.word_num, s.word_num}};
+	return write_with(s, plan, writer, threads, tick);
+}
@@ -0,0 +1,116 @@
+#ifndef SONGSIM_PLANNER_H
+#define SONGSIM_PLANNER_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "song_sim.h"
+
+/*!
+ * @brief The ways a full size image of a song can be drawn and written, from most to least memory hungry
+ */
+enum class strategy {
+	AUTO,		/*! Let plan_render pick 																*/
+	DENSE,		/*! Draw the whole image with render_song, then write it 								*/
+	RLE,		/*! Draw the whole image as runs of the same pixel with render_song_rle, then write it 	*/
+	SPARSE,		/*! Hold the occurrences of the word at each row, and draw each row from them 			*/
+	STREAMING	/*! Draw a few rows at a time straight from the word map, holding nothing else 			*/
+};
+
+/*!
+ * @brief What one strategy would cost for a song
+ */
+struct strategy_estimate {
+	strategy kind{strategy::DENSE};
+	std::uint64_t bytes{0};		/*! Memory needed on top of the song itself 	*/
+	double seconds{0};			/*! Roughly how long drawing takes, writing costs the same whichever is used 	*/
+	bool fits{true};			/*! Whether bytes is within the memory limit 	*/
+};
+
+/*!
+ * @brief How a song is going to be drawn
+ */
+struct render_plan {
+	strategy chosen{strategy::DENSE};
+	/*! Rows drawn at a time when streaming */
+	int chunk_rows{0};
+	/*! Cells where the words match, which is the same for every strategy */
+	std::uint64_t matches{0};
+	/*! Every strategy, in the order of the enum */
+	std::vector<strategy_estimate> estimates;
+
+	/*!
+	 * @brief The estimate for the chosen strategy
+	 */
+	const strategy_estimate& chosen_estimate() const;
+};
+
+/*!
+ * @brief The lower case name of a strategy, as --strategy takes it
+ */
+std::string strategy_name(strategy s);
+
+/*!
+ * @brief Read a strategy's name
+ * @param name The name, as given by strategy_name
+ * @param s Set to the strategy
+ * @return false if it isn't the name of a strategy
+ */
+bool parse_strategy(const std::string& name, strategy& s);
+
+/*!
+ * @brief Estimate every strategy for a song and pick the fastest one that fits in the memory limit
+ * @param s The song to draw
+ * @param memory_limit The most bytes to use on top of the song, 0 for no limit
+ * @param threads How many threads will draw, 0 means one per hardware thread
+ * @param forced Use this strategy whether or not it fits, unless it's AUTO
+ * @return The plan
+ * @throws std::runtime_error If nothing fits
+ */
+render_plan plan_render(const song& s, std::uint64_t memory_limit, unsigned threads = 1,
+						strategy forced = strategy::AUTO);
+
+/*!
+ * @brief Draw the song as render_song would, and write it, following the plan
+ * @param s The song to draw
+ * @param plan How to draw it
+ * @param os The stream to write to
+ * @param f The flavour of file to write
+ * @param threads How many threads to draw with, 0 means one per hardware thread
+ * @param tick Called every so often so the caller can show something's happening
+ * @param comment Put in the header as a comment, if it isn't empty
+ * @return The hash of the pixels written, which is the same whatever the plan
+ */
+std::uint64_t write_song(const song& s, const render_plan& plan, std::ostream& os, ppm_image::format f,
+						 unsigned threads = 1, const std::function<void()>& tick = {}, const std::string& comment = {});
+
+/*!
+ * @brief Draw the song as write_song would, and write it as a PNG
+ * @param s The song to draw, which needs at least one word
+ * @param plan How to draw it
+ * @param os The stream to write to, which should be binary
+ * @param threads How many threads to draw and compress with, 0 means one per hardware thread
+ * @param tick Called every so often so the caller can show something's happening
+ * @param comment Put in a tEXt chunk as a comment, if it isn't empty
+ * @return The hash of the pixels written, the same as write_song's
+ * @throws std::runtime_error If there are no words, since a PNG can't be empty
+ */
+std::uint64_t write_song_png(const song& s, const render_plan& plan, std::ostream& os, unsigned threads = 1,
+							 const std::function<void()>& tick = {}, const std::string& comment = {});
+
+/*!
+ * @brief Draw the song as write_song would, and write it as a QOI image, which has no room for a comment
+ * @param s The song to draw, which needs at least one word
+ * @param plan How to draw it
+ * @param os The stream to write to, which should be binary
+ * @param threads How many threads to draw with, 0 means one per hardware thread
+ * @param tick Called every so often so the caller can show something's happening
+ * @return The hash of the pixels written, the same as write_song's
+ * @throws std::runtime_error If there are no words, since a QOI image can't be empty
+ */
+std::uint64_t write_song_qoi(const song& s, const render_plan& plan, std::ostream& os, unsigned threads = 1,
+							 const std::function<void()>& tick = {});
+
+#endif //SONGSIM_PLANNER_H
@@ -0,0 +1,181 @@
+#include "pyramid.h"
+#include "blocks.h"
+#include "parallel.h"
+#include "trace.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/*!
+ * @brief One row of tiles in one level
+ */
+struct tile_row {
+	int level;
+	int row;
+};
+
+/*!
+ * @brief The column runs of one word which fall in one tile
+ */
+struct tile_entry {
+	int 		column;		/*! The tile column 										*/
+	std::size_t word;		/*! Index into the words present in the tile row 			*/
+	std::size_t first_run;	/*! The runs are [first_run, last_run) of the column runs 	*/
+	std::size_t last_run;
+};
+
+const char *aggregate_name(const aggregate mode) {
+	switch( mode ) {
+		case aggregate::COUNT: return "count";
+		case aggregate::MAX: return "max";
+		case aggregate::MEAN:
+		default: return "mean";
+	}
+}
+
+}
+
+std::size_t write_pyramid(const song &s, const pyramid_options &opts) {
+	if( opts.tile_size < 16 ) { throw std::runtime_error("The tile size must be at least 16"); }
+	const auto n = s.word_num;
+	const auto tile = opts.tile_size;
+	const auto k = std::numeric_limits<uint8_t>::max() / s.max_occurrences;
+
+	// The last level is full size, each one before it halves the size until it fits in one tile
+	auto levels = 1;
+	while( static_cast<long long>(tile) << (levels - 1) < n ) { levels++; }
+
+	// Which word is at each position, so the words in a band of rows can be found without searching them all
+	auto words = std::vector<const std::vector<int> *>{};
+	auto tokens = std::vector<int>(static_cast<std::size_t>(n));
+	for( const auto &unique_word: s.wordmap ) {
+		for( const auto &pos: unique_word.second ) { tokens[pos] = static_cast<int>(words.size()); }
+		words.push_back(&unique_word.second);
+	}
+
+	auto jobs = std::vector<tile_row>{};
+	for( auto level = levels - 1; level >= 0; level-- ) {
+		const auto span = static_cast<long long>(tile) << (levels - 1 - level);
+		for( auto row = 0; row * span < n; row++ ) {
+			jobs.push_back(tile_row{level, row});
+			fs::create_directories(fs::path{opts.out_dir} / std::to_string(level) / std::to_string(row));
+		}
+	}
+
+	auto written = std::atomic<std::size_t>{0};
+	parallel_jobs(jobs.size(), opts.threads, [&](const std::size_t job) {
+		const auto row_span = trace_span{"tile row", static_cast<int>(job)};
+		const auto level = jobs[job].level;
+		const auto scale = 1 << (levels - 1 - level);
+		const auto span = tile * scale;
+		const auto first_row = jobs[job].row * span;
+		const auto last_row = static_cast<int>(std::min<long long>(n, static_cast<long long>(first_row) + span));
+		const auto rows = block_axis{first_row, span, tile};
+
+		// Find the words in this band of rows and where each crosses the columns of every tile
+		auto seen = std::vector<bool>(words.size(), false);
+		auto present = std::vector<std::size_t>{};
+		auto row_runs = std::vector<std::vector<block_run>>{};
+		auto column_runs = std::vector<block_run>{};
+		auto entries = std::vector<tile_entry>{};
+		auto runs = std::vector<block_run>{};
+		for( auto pos = first_row; pos < last_row; pos++ ) {
+			const auto w = static_cast<std::size_t>(tokens[pos]);
+			if( seen[w] ) { continue; }
+			seen[w] = true;
+
+			const auto &indices = *words[w];
+			const auto begin = std::lower_bound(indices.begin(), indices.end(), first_row);
+			const auto end = std::lower_bound(begin, indices.end(), last_row);
+			row_runs.emplace_back();
+			make_runs(indices, begin, end, rows, row_runs.back());
+
+			for( auto it = indices.begin(); it != indices.end(); ) {
+				const auto column = *it / span;
+				const auto column_end = std::lower_bound(it, indices.end(), (column + 1) * span);
+				make_runs(indices, it, column_end, block_axis{column * span, span, tile}, runs);
+				entries.push_back(tile_entry{column, present.size(), column_runs.size(), column_runs.size() + runs.size()});
+				column_runs.insert(column_runs.end(), runs.begin(), runs.end());
+				it = column_end;
+			}
+			present.push_back(w);
+		}
+		std::stable_sort(entries.begin(), entries.end(), [](const tile_entry &a, const tile_entry &b) {
+			return a.column < b.column;
+		});
+
+		// Then draw each tile which has something in it
+		const auto height = (last_row - first_row + scale - 1) / scale;
+		auto totals = std::vector<block_totals>{};
+		for( auto e = entries.begin(); e != entries.end(); ) {
+			const auto column = e->column;
+			const auto first_col = column * span;
+			const auto last_col = static_cast<int>(std::min<long long>(n, static_cast<long long>(first_col) + span));
+			const auto width = (last_col - first_col + scale - 1) / scale;
+			totals.assign(static_cast<std::size_t>(height) * width, block_totals{});
+
+			for( ; e != entries.end() && e->column == column; ++e ) {
+				const auto &indices = *words[present[e->word]];
+				const auto b = static_cast<std::uint64_t>(indices.size() * k);
+				for( const auto &xr: row_runs[e->word] ) {
+					for( auto yr = e->first_run; yr < e->last_run; yr++ ) {
+						accumulate(totals[static_cast<std::size_t>(xr.block) * width + column_runs[yr].block],
+								   xr, column_runs[yr], k, b, opts.mode);
+					}
+				}
+			}
+
+			auto p = ppm_image{image_size{width, height}, rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+			auto encode = std::optional<trace_span>{std::in_place, "encode"};
+			for( auto y = 0; y < height; y++ ) {
+				const auto rows_in_block = std::min(scale, last_row - (first_row + y * scale));
+				for( auto x = 0; x < width; x++ ) {
+					const auto &t = totals[static_cast<std::size_t>(y) * width + x];
+					if( t.count == 0 ) { continue; }
+					const auto cells = static_cast<double>(rows_in_block) * std::min(scale, last_col - (first_col + x * scale));
+					p[y][x] = block_colour(t, opts.mode, cells);
+				}
+			}
+
+			encode.reset();
+
+			const auto write_span = trace_span{"write"};
+			const auto path = fs::path{opts.out_dir} / std::to_string(level) / std::to_string(jobs[job].row) /
+							  (std::to_string(column) + ".ppm");
+			auto out = std::ofstream{path, std::ios::binary};
+			p.write(out, ppm_image::format::P6);
+			if( !out ) { throw std::runtime_error("Unable to write " + path.string()); }
+			written++;
+		}
+	});
+
+	auto manifest = std::ofstream{fs::path{opts.out_dir} / "manifest.json"};
+	manifest << "{\n"
+			 << "  \"width\": " << n << ",\n"
+			 << "  \"height\": " << n << ",\n"
+			 << "  \"tile_size\": " << tile << ",\n"
+			 << "  \"format\": \"P6\",\n"
+			 << "  \"path\": \"{level}/{row}/{column}.ppm\",\n"
+			 << "  \"missing_tiles\": \"white\",\n"
+			 << "  \"aggregate\": \"" << aggregate_name(opts.mode) << "\",\n"
+			 << "  \"tiles\": " << written << ",\n"
+			 << "  \"levels\": [\n";
+	for( auto level = 0; level < levels; level++ ) {
+		const auto scale = 1 << (levels - 1 - level);
+		const auto size = (n + scale - 1) / scale;
+		manifest << "    { \"level\": " << level << ", \"scale\": " << scale << ", \"width\": " << size
+				 << ", \"height\": " << size << ", \"columns\": " << (size + tile - 1) / tile
+				 << ", \"rows\": " << (size + tile - 1) / tile << " }" << (level + 1 < levels ? "," : "") << "\n";
+	}
+	manifest << "  ]\n}\n";
+	if( !manifest ) { throw std::runtime_error("Unable to write the manifest in " + opts.out_dir); }
+
+	return written;
+}
@@ -0,0 +1,33 @@
+#ifndef SONGSIM_PYRAMID_H
+#define SONGSIM_PYRAMID_H
+
+#include "density.h"
+#include <string>
+
+/*!
+ * @brief How to write a tile pyramid
+ */
+struct pyramid_options {
+	/*! The directory the tiles and manifest are written to */
+	std::string out_dir{"."};
+	/*! The width and height of each tile in pixels */
+	int tile_size{256};
+	/*! How the words are combined in the scaled down levels */
+	aggregate mode{aggregate::MEAN};
+	/*! How many threads to draw with, 0 means one per hardware thread */
+	unsigned threads{0};
+};
+
+/*!
+ * @brief Write the song as a pyramid of P6 tiles for zooming around in, without ever holding the full size image.
+ * Level 0 is the whole song scaled down to fit in one tile, each level after it is twice the size of the one before
+ * and the last is full size. Tiles are written to <out_dir>/<level>/<row>/<column>.ppm along with a manifest.json
+ * describing the levels. Tiles which would be all white aren't written.
+ * @param s The song to draw
+ * @param opts How to draw it
+ * @return The number of tiles written
+ * @throw std::runtime_error if a tile or the manifest can't be written
+ */
+std::size_t write_pyramid(const song& s, const pyramid_options& opts);
+
+#endif //SONGSIM_PYRAMID_H
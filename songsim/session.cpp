@@ -0,0 +1,211 @@
+#include "session.h"
+#include "draw.h"
+#include "mapped_file.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr char session_magic[] = "SONGSIM1";
+
+/*!
+ * The width and height are padded to a fixed number of characters so that the pixels always
+ * start at the same place in the file however big the image gets.
+ */
+constexpr auto size_digits = 10;
+constexpr auto header_bytes = std::size_t{3 + size_digits + 1 + size_digits + 5};
+
+std::string header(const int n) {
+	auto os = std::ostringstream{};
+	os << "P6\n" << std::setw(size_digits) << n << ' ' << std::setw(size_digits) << n << "\n255\n";
+	return os.str();
+}
+
+/*!
+ * @brief The state kept between updates
+ */
+struct session_state {
+	song 			s;
+	std::uint64_t 	input_offset{0};	/*! How far through the text has been read */
+};
+
+template<typename T>
+void write_value(std::ostream &os, const T &v) {
+	os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+template<typename T>
+void read_value(std::istream &is, T &v) {
+	is.read(reinterpret_cast<char *>(&v), sizeof(v));
+}
+
+/*!
+ * @brief Load a session, checking everything that's read so a cut short or corrupt one can't draw outside the image
+ * @return false if there isn't one, or it isn't valid
+ */
+bool load(const std::string &path, session_state &state) {
+	auto in = std::ifstream{path, std::ios::binary | std::ios::ate};
+	if( !in.is_open()) { return false; }
+	const auto file_bytes = static_cast<std::uint64_t>(in.tellg());
+	in.seekg(0);
+	const auto left = [&] { return file_bytes - static_cast<std::uint64_t>(in.tellg()); };
+
+	char magic[sizeof(session_magic)] = {};
+	in.read(magic, sizeof(magic));
+	if( std::memcmp(magic, session_magic, sizeof(magic)) != 0 ) { return false; }
+
+	auto words = std::int32_t{0};
+	auto distinct = std::uint64_t{0};
+	read_value(in, state.input_offset);
+	read_value(in, words);
+	read_value(in, distinct);
+	if( !in || words < 0 ) { return false; }
+	state.s.word_num = words;
+	for( std::uint64_t w = 0; w < distinct; w++ ) {
+		auto length = std::uint32_t{0};
+		auto count = std::uint64_t{0};
+		read_value(in, length);
+		if( !in || length > left()) { return false; }
+		auto word = std::string(length, '\0');
+		in.read(&word[0], length);
+		read_value(in, count);
+		if( !in || count == 0 || count > static_cast<std::uint64_t>(words) || count * sizeof(int) > left()) { return false; }
+		auto &indices = state.s.wordmap[word];
+		indices.resize(count);
+		in.read(reinterpret_cast<char *>(indices.data()), static_cast<std::streamsize>(count * sizeof(int)));
+		if( !in ) { return false; }
+
+		// Where the word occurs, in order, each of them a row and column of the image
+		for( std::size_t i = 0; i < indices.size(); i++ ) {
+			if( indices[i] < 0 || indices[i] >= words || (i > 0 && indices[i] <= indices[i - 1])) { return false; }
+		}
+		state.s.max_occurrences = std::max(state.s.max_occurrences, indices.size());
+	}
+	return true;
+}
+
+/*!
+ * @brief Save a session, replacing the old one only once the new one is complete
+ */
+void save(const std::string &path, const session_state &state) {
+	const auto temp = path + ".tmp";
+	{
+		auto out = std::ofstream{temp, std::ios::binary | std::ios::trunc};
+		out.write(session_magic, sizeof(session_magic));
+		write_value(out, state.input_offset);
+		write_value(out, static_cast<std::int32_t>(state.s.word_num));
+		write_value(out, static_cast<std::uint64_t>(state.s.wordmap.size()));
+		for( const auto &unique_word: state.s.wordmap ) {
+			write_value(out, static_cast<std::uint32_t>(unique_word.first.size()));
+			out.write(unique_word.first.data(), static_cast<std::streamsize>(unique_word.first.size()));
+			write_value(out, static_cast<std::uint64_t>(unique_word.second.size()));
+			out.write(reinterpret_cast<const char *>(unique_word.second.data()),
+					  static_cast<std::streamsize>(unique_word.second.size() * sizeof(int)));
+		}
+		if( !out ) { throw std::runtime_error("Unable to write " + temp); }
+	}
+	if( std::rename(temp.c_str(), path.c_str()) != 0 ) { throw std::runtime_error("Unable to replace " + path); }
+}
+
+/*!
+ * @brief The number of words the image already holds, or -1 if it isn't one of ours
+ */
+int image_words(const std::string &path) {
+	auto in = std::ifstream{path, std::ios::binary};
+	auto head = std::string(header_bytes, '\0');
+	if( !in.read(&head[0], static_cast<std::streamsize>(header_bytes))) { return -1; }
+	auto is = std::istringstream{head.substr(3)};
+	auto w = 0, h = 0;
+	if( !(is >> w >> h) || w != h || head != header(w)) { return -1; }
+
+	struct stat st{};
+	if( stat(path.c_str(), &st) != 0 ||
+		static_cast<std::size_t>(st.st_size) != header_bytes + static_cast<std::size_t>(w) * w * 3 ) { return -1; }
+	return w;
+}
+
+}
+
+session_update update_session(const std::string &session_path, const std::string &input_path,
+							  const std::string &output_path) {
+	auto state = session_state{};
+	auto old_words = image_words(output_path);
+	if( !load(session_path, state) || old_words != state.s.word_num ) {
+		state = session_state{};
+		old_words = 0;
+	}
+
+	auto input = std::ifstream{input_path, std::ios::binary};
+	if( !input.is_open()) { throw std::runtime_error("Unable to open " + input_path); }
+	input.seekg(0, std::ios::end);
+	const auto input_size = static_cast<std::uint64_t>(input.tellg());
+	if( input_size < state.input_offset ) {
+		// The text has been replaced rather than added to, so start again
+		state = session_state{};
+		old_words = 0;
+	}
+	input.seekg(static_cast<std::streamoff>(state.input_offset));
+	auto text = std::string(static_cast<std::size_t>(input_size - state.input_offset), '\0');
+	input.read(&text[0], static_cast<std::streamsize>(text.size()));
+
+	// Leave any partly written word at the end for next time
+	auto complete = text.size();
+	while( complete > 0 && !std::isspace(static_cast<unsigned char>(text[complete - 1]))) { complete--; }
+	text.resize(complete);
+	state.input_offset += complete;
+
+	const auto old_k = std::numeric_limits<uint8_t>::max() / state.s.max_occurrences;
+	auto added = std::istringstream{text};
+	add_words(state.s, added);
+	const auto n = state.s.word_num;
+	const auto k = std::numeric_limits<uint8_t>::max() / state.s.max_occurrences;
+
+	auto result = session_update{};
+	result.old_words = old_words;
+	result.words = n;
+	result.redrawn = old_words > 0 && old_k != k;
+
+	{
+		auto image = mapped_file{output_path, header_bytes + static_cast<std::size_t>(n) * n * 3};
+		static_assert(sizeof(rgb_pixel) == 3, "The mapped pixels are viewed as rgb_pixels");
+		auto *pixels = reinterpret_cast<rgb_pixel *>(image.data() + header_bytes);
+		const auto grid = mutable_image_view{pixels, image_size{n, n}, n};
+
+		// Move the old rows out to their new width, which blit does last first so nothing is overwritten
+		// before it's moved, and make the new columns and rows white
+		if( n != old_words ) {
+			const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+			blit(image_view{pixels, image_size{old_words, old_words}, old_words}, grid, 0, 0);
+			fill_rect(grid, {old_words, 0, n - old_words, old_words}, white);
+			fill_rect(grid, {0, old_words, n, n - old_words}, white);
+		}
+		const auto head = header(n);
+		std::memcpy(image.data(), head.data(), header_bytes);
+
+		// The blue of a word depends on how often it occurs, so every cell of a word that's occurred again is redrawn
+		for( const auto &unique_word: state.s.wordmap ) {
+			const auto &indices = unique_word.second;
+			if( !result.redrawn && indices.back() < old_words ) { continue; }
+
+			const auto b = static_cast<uint8_t>(indices.size() * k);
+			for( std::size_t x = 0; x < indices.size(); x++ ) {
+				const auto row = grid[indices[x]];
+				const auto r = static_cast<uint8_t>((x + 1) * k);
+				for( std::size_t y = 0; y < indices.size(); y++ ) {
+					row[indices[y]] = rgb_pixel{r, static_cast<uint8_t>((y + 1) * k), b};
+				}
+				result.cells_written += indices.size();
+			}
+		}
+	}
+
+	save(session_path, state);
+	return result;
+}
@@ -0,0 +1,39 @@
+#ifndef SONGSIM_SESSION_H
+#define SONGSIM_SESSION_H
+
+#include "song_sim.h"
+#include <string>
+
+/*!
+ * @brief What an update to a session did
+ */
+struct session_update {
+	int 		old_words{0};		/*! How many words the image had before 				*/
+	int 		words{0};			/*! How many it has now 								*/
+	std::size_t cells_written{0};	/*! How many matching cells were drawn 					*/
+	bool 		redrawn{false};		/*! Whether every matching cell had to be drawn again 	*/
+};
+
+/*!
+ * @brief Bring a P6 image up to date with a text which is only ever added to at the end.
+ *
+ * The words read so far are kept in the session file. Only the words added since the last update are read,
+ * the image is grown in place to make room for their rows and columns, and only the cells of the words
+ * which occur again are drawn. If the most frequent word becomes frequent enough to change the colour scale
+ * every matching cell is drawn again, still without touching the white ones.
+ *
+ * Growing the image has to move each existing row along in the file, but that's just copying bytes.
+ * A word at the very end of the text with no whitespace after it is left for the next update,
+ * in case it's only partly written.
+ *
+ * If the session or the image don't exist, or don't match each other, the image is drawn from scratch.
+ * @param session_path The file the words read so far are kept in
+ * @param input_path The text being drawn
+ * @param output_path The P6 image to keep up to date
+ * @return What was done
+ * @throw std::runtime_error if any of the files can't be read or written
+ */
+session_update update_session(const std::string& session_path, const std::string& input_path,
+							  const std::string& output_path);
+
+#endif //SONGSIM_SESSION_H
@@ -0,0 +1,151 @@
+#include "song_sim.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <limits>
+
+song read_song(std::istream &is) {
+	auto s = song{};
+	add_words(s, is);
+	return s;
+}
+
+void add_words(song &s, std::istream &is) {
+	auto text = read_text(is);
+	index_words(s, tokenise(text));
+}
+
+std::string read_text(std::istream &is) {
+	return std::string{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+}
+
+std::vector<std::string_view> tokenise(std::string &text) {
+	auto words = std::vector<std::string_view>{};
+	auto out = std::size_t{0};
+	auto in = std::size_t{0};
+	const auto space = [&](const std::size_t i) { return std::isspace(static_cast<unsigned char>(text[i])) != 0; };
+
+	while( in < text.size()) {
+		while( in < text.size() && space(in)) { in++; }
+		if( in == text.size()) { break; }
+
+		// Copy the word down over any punctuation already dropped, it can only ever shrink
+		const auto start = out;
+		for( ; in < text.size() && !space(in); in++ ) {
+			const auto c = static_cast<unsigned char>(text[in]);
+			if( !std::ispunct(c)) { text[out++] = static_cast<char>(std::tolower(c)); }
+		}
+		words.emplace_back(text.data() + start, out - start);
+	}
+	return words;
+}
+
+void index_words(song &s, const std::vector<std::string_view> &words) {
+	auto key = std::string{};
+	for( const auto &word: words ) {
+		key.assign(word);
+		auto &occurrences = s.wordmap[key];
+		occurrences.push_back(s.word_num);
+		if( occurrences.size() > s.max_occurrences ) { s.max_occurrences = occurrences.size(); }
+		s.word_num++;
+	}
+}
+
+std::uint64_t input_hash(const std::string_view text, const std::string_view options) {
+	// The length first, so where the text stops and the options start can't be moved without changing the hash
+	auto h = xxh64{};
+	unsigned char length[8];
+	for( auto i = 0; i < 8; i++ ) { length[i] = static_cast<unsigned char>(static_cast<std::uint64_t>(text.size()) >> (8 * i)); }
+	h.update(length, sizeof(length));
+	h.update(text.data(), text.size());
+	h.update(options.data(), options.size());
+	return h.digest();
+}
+
+std::size_t render_bytes(const song &s) {
+	const auto n = static_cast<std::size_t>(s.word_num);
+	return n * n * sizeof(rgb_pixel) + n * sizeof(int);
+}
+
+ppm_image render_song(const song &s, const unsigned threads, const std::function<void()> &tick) {
+	auto p = blank_image(s);
+	colour_song(s, p, threads, tick);
+	return p;
+}
+
+ppm_image blank_image(const song &s) {
+	// Create background of image totally white
+	return ppm_image{image_size{s.word_num, s.word_num}, rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+}
+
+void colour_song(const song &s, ppm_image &p, const unsigned threads, const std::function<void()> &tick) {
+	// Each band owns the rows [first, last) so no two threads ever write the same pixel
+	parallel_bands(s.word_num, threads, [&](const int first, const int last, const int band) {
+		const auto span = trace_span{"render band", band};
+		colour_rows(s, p, first, last, 0, band == 0 ? tick : std::function<void()>{});
+	});
+}
+
+namespace {
+
+/*!
+ * @brief colour_rows for any image
+ * @param row_of Gives something to set the cells of a row of the song with, as row(y, colour)
+ */
+template<typename RowOf>
+void colour_cells(const song &s, const int first, const int last, const std::function<void()> &tick, RowOf row_of) {
+
+	// k is the multiplier for the values, so that the word with the most occurrences is the bluest
+	const auto k = std::numeric_limits<uint8_t>::max() / s.max_occurrences;
+
+	for( const auto &unique_word : s.wordmap ) {
+		const auto &indices = unique_word.second;
+
+		// Each word has a number of indices, so loop over the indices and use each
+		// as an x and as a y value to make the grid.
+		const auto begin = std::lower_bound(indices.begin(), indices.end(), first);
+		const auto end = std::lower_bound(begin, indices.end(), last);
+		for( auto x = begin; x != end; ++x ) {
+			// Offset by one to prevent having a multiplier of 0
+			const auto vect_idx_x = static_cast<std::size_t>(x - indices.begin()) + 1;
+			auto row = row_of(*x);
+			auto vect_idx_y = std::size_t{0};
+			for( const auto &y: indices ) {
+				vect_idx_y++;
+
+				// These colours values are fairly random:
+				// make there more red when the x index increases
+				// make there more blue when the y index increases
+				// make the blue more intense based on how many occurrences of this word
+				const auto r = vect_idx_x * k;
+				const auto g = vect_idx_y * k;
+				const auto b = indices.size() * k;
+				row(y, rgb_pixel{static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b)});
+			}
+		}
+		if( tick ) { tick(); }
+	}
+}
+
+}
+
+void colour_rows(const song &s, ppm_image &p, const int first, const int last, const int origin,
+				 const std::function<void()> &tick) {
+	colour_cells(s, first, last, tick, [&](const int x) {
+		return [row = p[x - origin]](const int y, const rgb_pixel &colour) { row[y] = colour; };
+	});
+}
+
+rle_image render_song_rle(const song &s, const unsigned threads, const std::function<void()> &tick) {
+	auto p = rle_image{image_size{s.word_num, s.word_num}, rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+	// Each row's runs are only touched by the band it's in, and each row is set from left to right
+	parallel_bands(s.word_num, threads, [&](const int first, const int last, const int band) {
+		const auto span = trace_span{"render band", band};
+		colour_cells(s, first, last, band == 0 ? tick : std::function<void()>{}, [&](const int x) {
+			return [&p, x](const int y, const rgb_pixel &colour) { p.set(y, x, colour); };
+		});
+	});
+	return p;
+}
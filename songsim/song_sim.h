@@ -0,0 +1,127 @@
+#ifndef SONGSIM_SONG_SIM_H
+#define SONGSIM_SONG_SIM_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ppm_file.h"
+#include "rle_image.h"
+
+/*!
+ * @brief The words of a text and every position each of them occurs at
+ */
+struct song {
+	/*! Each distinct word mapped to the word numbers it appears at, in ascending order */
+	std::unordered_map<std::string, std::vector<int>> wordmap;
+	/*! The total number of words read */
+	int word_num{0};
+	/*!
+	 * The maximum number of occurrences of any word, used for evenly distributing the colour values.
+	 * Starts at one to prevent a divide by 0 error if there's only one word.
+	 */
+	std::vector<int>::size_type max_occurrences{1};
+};
+
+/*!
+ * @brief Read whitespace separated words from the stream, ignoring punctuation and case
+ * @param is The stream to read from
+ * @return The indexed words
+ */
+song read_song(std::istream& is);
+
+/*!
+ * @brief Carry on reading words into a song, numbering them on from the words it already has
+ * @param s The song to add to
+ * @param is The stream to read from
+ */
+void add_words(song& s, std::istream& is);
+
+/*
+ * The steps read_song goes through, for when they need to be done or timed separately
+ */
+
+/*!
+ * @brief Read everything left in the stream
+ * @param is The stream to read from
+ * @return The text
+ */
+std::string read_text(std::istream& is);
+
+/*!
+ * @brief Split the text into words, taking the punctuation out of them and making them lower case
+ * @param text The text, which is changed in place to hold the cleaned up words
+ * @return The words, which point into the text
+ */
+std::vector<std::string_view> tokenise(std::string& text);
+
+/*!
+ * @brief Add the words to the song's word map, numbering them on from the words it already has
+ * @param s The song to add to
+ * @param words The words to add, already cleaned up by tokenise
+ */
+void index_words(song& s, const std::vector<std::string_view>& words);
+
+/*!
+ * @brief A fingerprint of a text and the options it's drawn with, to tell whether it's been drawn before
+ * @param text The text as it was read, before tokenise
+ * @param options Whatever else changes the image, such as "max-size=512x512 aggregate=mean"
+ * @return The XXH64 of the text's length, the text and the options
+ */
+std::uint64_t input_hash(std::string_view text, std::string_view options);
+
+/*!
+ * @brief Estimate how much memory rendering the song will need
+ * @param s The song
+ * @return The number of bytes the image will hold
+ */
+std::size_t render_bytes(const song& s);
+
+/*!
+ * @brief Draw the song as a word_num x word_num grid, white except where the word at x is the same as the word at y
+ * @param s The song to draw
+ * @param threads How many threads to draw with, each takes a band of rows. 0 means one per hardware thread
+ * @param tick Called every so often from the first band so the caller can show something's happening
+ * @return The image
+ */
+ppm_image render_song(const song& s, unsigned threads = 1, const std::function<void()>& tick = {});
+
+/*!
+ * @brief The first step of render_song, an all white word_num x word_num image
+ */
+ppm_image blank_image(const song& s);
+
+/*!
+ * @brief The second step of render_song, colour in the cells where the words match
+ * @param s The song to draw
+ * @param p The image from blank_image
+ * @param threads How many threads to draw with, each takes a band of rows. 0 means one per hardware thread
+ * @param tick Called every so often from the first band so the caller can show something's happening
+ */
+void colour_song(const song& s, ppm_image& p, unsigned threads = 1, const std::function<void()>& tick = {});
+
+/*!
+ * @brief Colour in the cells where the words match for some of the rows, on a single thread
+ * @param s The song to draw
+ * @param p Where the rows are drawn, row origin of the song being its first row
+ * @param first The first row to draw
+ * @param last One past the last row to draw
+ * @param origin The row of the song held in the first row of p
+ * @param tick Called after each word
+ */
+void colour_rows(const song& s, ppm_image& p, int first, int last, int origin = 0, const std::function<void()>& tick = {});
+
+/*!
+ * @brief Draw the song as render_song does, but held as runs of the same pixel along each row.
+ * Most of the image is white, so it needs memory for the matching cells rather than for every cell.
+ * @param s The song to draw
+ * @param threads How many threads to draw with, each takes a band of rows. 0 means one per hardware thread
+ * @param tick Called every so often from the first band so the caller can show something's happening
+ * @return The image
+ */
+rle_image render_song_rle(const song& s, unsigned threads = 1, const std::function<void()>& tick = {});
+
+#endif //SONGSIM_SONG_SIM_H
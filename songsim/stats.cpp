@@ -0,0 +1,81 @@
+#include "stats.h"
+#include <iomanip>
+#include <sys/resource.h>
+
+namespace {
+
+/*!
+ * @brief Everything derived from the phases, worked out the same way for both formats
+ */
+struct summary {
+	double total{0};
+	double tokenize{0};
+	double drawing{0};
+};
+
+summary summarise(const run_stats &s) {
+	auto result = summary{};
+	for( const auto &phase: s.phases ) {
+		result.total += phase.second;
+		if( phase.first == "tokenize" ) { result.tokenize += phase.second; }
+		// Everything after the words have been read and indexed is drawing or writing the image
+		if( phase.first != "read" && phase.first != "tokenize" && phase.first != "index" ) { result.drawing += phase.second; }
+	}
+	return result;
+}
+
+double per_second(const std::uint64_t count, const double seconds) {
+	return seconds > 0 ? static_cast<double>(count) / seconds : 0;
+}
+
+}
+
+void run_stats::write_text(std::ostream &os) const {
+	const auto sum = summarise(*this);
+	os << std::setprecision(6);
+	for( const auto &phase: phases ) {
+		os << std::left << std::setw(20) << phase.first + "_seconds" << ' ' << phase.second << "\n";
+	}
+	os << std::setw(20) << "total_seconds" << ' ' << sum.total << "\n"
+	   << std::setw(20) << "tokens" << ' ' << tokens << "\n"
+	   << std::setw(20) << "distinct_words" << ' ' << distinct_words << "\n"
+	   << std::setw(20) << "tokens_per_second" << ' ' << per_second(tokens, sum.tokenize) << "\n"
+	   << std::setw(20) << "pixels" << ' ' << pixels << "\n"
+	   << std::setw(20) << "pixels_per_second" << ' ' << per_second(pixels, sum.drawing) << "\n"
+	   << std::setw(20) << "bytes_written" << ' ' << bytes_written << "\n";
+	if( !strategy.empty()) {
+		os << std::setw(20) << "strategy" << ' ' << strategy << "\n"
+		   << std::setw(20) << "planned_bytes" << ' ' << planned_bytes << "\n";
+	}
+	os << std::setw(20) << "peak_rss_bytes" << ' ' << peak_rss_bytes() << std::right << std::endl;
+}
+
+void run_stats::write_json(std::ostream &os) const {
+	const auto sum = summarise(*this);
+	os << std::setprecision(9) << "{\"phases\": {";
+	for( std::size_t i = 0; i < phases.size(); i++ ) {
+		os << (i ? ", " : "") << "\"" << phases[i].first << "\": " << phases[i].second;
+	}
+	os << "}, \"total_seconds\": " << sum.total
+	   << ", \"tokens\": " << tokens
+	   << ", \"distinct_words\": " << distinct_words
+	   << ", \"tokens_per_second\": " << per_second(tokens, sum.tokenize)
+	   << ", \"pixels\": " << pixels
+	   << ", \"pixels_per_second\": " << per_second(pixels, sum.drawing)
+	   << ", \"bytes_written\": " << bytes_written;
+	if( !strategy.empty()) {
+		os << ", \"strategy\": \"" << strategy << "\", \"planned_bytes\": " << planned_bytes;
+	}
+	os << ", \"peak_rss_bytes\": " << peak_rss_bytes() << "}" << std::endl;
+}
+
+std::uint64_t run_stats::peak_rss_bytes() {
+	struct rusage usage{};
+	if( getrusage(RUSAGE_SELF, &usage) != 0 ) { return 0; }
+#ifdef __APPLE__
+	return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+	// Linux reports it in kilobytes
+	return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
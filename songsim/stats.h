@@ -0,0 +1,67 @@
+#ifndef SONGSIM_STATS_H
+#define SONGSIM_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "trace.h"
+
+/*!
+ * @brief How long each phase of a run took, and how much it did
+ */
+struct run_stats {
+	/*! The wall time of each phase in seconds, in the order they ran */
+	std::vector<std::pair<std::string, double>> phases;
+	std::uint64_t tokens{0};			/*! Words read 									*/
+	std::uint64_t distinct_words{0};	/*! Different words read 						*/
+	std::uint64_t pixels{0};			/*! Pixels drawn 								*/
+	std::uint64_t bytes_written{0};		/*! Size of the output, 0 if it wasn't measured 	*/
+	std::string strategy;				/*! How the image was drawn, empty if not planned 	*/
+	std::uint64_t planned_bytes{0};		/*! Memory the strategy was expected to need 		*/
+
+	/*!
+	 * @brief Run f and record how long it took as a phase, which is also traced as a span
+	 * @param phase The name of the phase, must outlive any trace
+	 * @param f What to do
+	 * @return Whatever f returns
+	 */
+	template<typename F>
+	auto time(const char* phase, F&& f) {
+		const auto span = trace_span{phase};
+		const auto start = std::chrono::steady_clock::now();
+		const auto record = [&] {
+			phases.emplace_back(phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		};
+		if constexpr( std::is_void_v<decltype(f())> ) {
+			f();
+			record();
+		}
+		else {
+			auto result = f();
+			record();
+			return result;
+		}
+	}
+
+	/*!
+	 * @brief Write the stats as "name value" lines
+	 */
+	void write_text(std::ostream& os) const;
+
+	/*!
+	 * @brief Write the stats as a single line JSON object
+	 */
+	void write_json(std::ostream& os) const;
+
+	/*!
+	 * @brief The most memory the process has had resident at once
+	 * @return The size in bytes, 0 if it can't be found
+	 */
+	static std::uint64_t peak_rss_bytes();
+};
+
+#endif //SONGSIM_STATS_H
@@ -0,0 +1,78 @@
+#include "trace.h"
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct trace_event {
+	const char* 	name;
+	int 			arg;
+	std::int64_t 	start_ns;
+	std::int64_t 	duration_ns;
+};
+
+/*!
+ * @brief The spans recorded by one thread, only ever appended to by that thread
+ */
+struct thread_buffer {
+	int 						tid;
+	std::vector<trace_event> 	events;
+};
+
+std::chrono::steady_clock::time_point origin;
+
+/*!
+ * @brief Every thread's buffer, so they outlive their threads until they're written.
+ * The lock is only taken the first time a thread records something, and when writing.
+ */
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<thread_buffer>> buffers;
+
+thread_buffer &this_thread_buffer() {
+	thread_local thread_buffer *buffer = nullptr;
+	if( !buffer ) {
+		auto lock = std::lock_guard<std::mutex>{buffers_mutex};
+		buffers.push_back(std::make_unique<thread_buffer>());
+		buffers.back()->tid = static_cast<int>(buffers.size());
+		buffer = buffers.back().get();
+	}
+	return *buffer;
+}
+
+}
+
+std::atomic<bool> tracer::_enabled{false};
+
+void tracer::enable() {
+	origin = std::chrono::steady_clock::now();
+	_enabled.store(true, std::memory_order_release);
+}
+
+void tracer::record(const char *name, const int arg, const std::chrono::steady_clock::time_point start,
+					const std::chrono::steady_clock::time_point end) {
+	using std::chrono::duration_cast;
+	using std::chrono::nanoseconds;
+	this_thread_buffer().events.push_back(trace_event{
+			name, arg, duration_cast<nanoseconds>(start - origin).count(), duration_cast<nanoseconds>(end - start).count()});
+}
+
+void tracer::write(std::ostream &os) {
+	auto lock = std::lock_guard<std::mutex>{buffers_mutex};
+	os << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	auto first = true;
+	for( const auto &buffer: buffers ) {
+		os << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+		   << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+		first = false;
+		for( const auto &e: buffer->events ) {
+			// Chrome wants microseconds
+			os << ",\n{\"name\": \"" << e.name;
+			if( e.arg >= 0 ) { os << " " << e.arg; }
+			os << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid << ", \"ts\": " << e.start_ns / 1e3
+			   << ", \"dur\": " << e.duration_ns / 1e3 << "}";
+		}
+	}
+	os << "\n]}\n";
+}
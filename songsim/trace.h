@@ -0,0 +1,77 @@
+#ifndef SONGSIM_TRACE_H
+#define SONGSIM_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/*!
+ * @brief Records spans of time from every thread, to be viewed as a timeline in chrome://tracing or Perfetto.
+ * Each thread appends to its own buffer without taking a lock. Until it's enabled nothing is recorded,
+ * and a span costs one relaxed atomic load.
+ */
+class tracer {
+public:
+	/*!
+	 * @brief Start recording, times in the trace are from now
+	 */
+	static void enable();
+
+	/*!
+	 * @brief Whether spans are being recorded
+	 */
+	static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	/*!
+	 * @brief Write everything recorded in Chrome's trace event format.
+	 * Only call this once the threads being traced have finished.
+	 * @param os The stream to write to
+	 */
+	static void write(std::ostream& os);
+
+	/*!
+	 * @brief Record a span on the calling thread
+	 * @param name What was happening
+	 * @param arg A number to add to the name, such as the band, or -1 for none
+	 * @param start When it started
+	 * @param end When it ended
+	 */
+	static void record(const char* name, int arg, std::chrono::steady_clock::time_point start,
+					   std::chrono::steady_clock::time_point end);
+
+private:
+	static std::atomic<bool> _enabled;
+};
+
+/*!
+ * @brief Records the time from its construction to its destruction as a span, if the tracer is enabled
+ */
+class trace_span {
+public:
+	/*!
+	 * @param name What's happening, must outlive the span
+	 * @param arg A number to add to the name, such as the band, or -1 for none
+	 */
+	explicit trace_span(const char* name, const int arg = -1)
+			: _name(name), _arg(arg) {
+		if( tracer::enabled()) { _start = std::chrono::steady_clock::now(); }
+	}
+
+	trace_span(const trace_span&) = delete;
+	trace_span& operator=(const trace_span&) = delete;
+
+	~trace_span() {
+		if( tracer::enabled() && _start != std::chrono::steady_clock::time_point{}) {
+			tracer::record(_name, _arg, _start, std::chrono::steady_clock::now());
+		}
+	}
+
+private:
+	const char* 							_name;
+	int 									_arg;
+	std::chrono::steady_clock::time_point 	_start{};
+};
+
+#endif //SONGSIM_TRACE_H
@@ -0,0 +1,172 @@
+#include "blur.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/*! Roughly how many bytes of rows the columns pass keeps at once for each strip, to stay in the L2 cache */
+constexpr auto strip_budget = std::size_t{256 * 1024};
+
+blur_kernel normalised(const int radius, const std::vector<double> &weights) {
+	constexpr auto one = 1 << blur_kernel::bits;
+	if( weights.size() > static_cast<std::size_t>(one)) {
+		throw std::runtime_error("A blur radius of " + std::to_string(radius) + " is too wide, some pixels would count for nothing");
+	}
+
+	auto k = blur_kernel{};
+	k.radius = radius;
+	auto total = 0.0;
+	for( const auto w: weights ) { total += w; }
+
+	// Round each weight down, then hand out what that lost a unit at a time to the weights it lost the most from.
+	// It's less than a unit each so none of them moves by more than one, and a pair either side of the middle
+	// gets one at a time so the kernel stays symmetric, any odd one left going to the middle.
+	auto lost = std::vector<double>{};
+	auto sum = 0;
+	for( const auto w: weights ) {
+		const auto exact = w / total * one;
+		k.weights.push_back(static_cast<std::int16_t>(std::floor(exact)));
+		lost.push_back(exact - k.weights.back());
+		sum += k.weights.back();
+	}
+	auto left = one - sum;
+	if( left % 2 != 0 ) {
+		k.weights[radius]++;
+		left--;
+	}
+	auto sides = std::vector<int>(static_cast<std::size_t>(radius));
+	for( auto d = 0; d < radius; d++ ) { sides[d] = d + 1; }
+	std::stable_sort(sides.begin(), sides.end(), [&](const int a, const int b) { return lost[radius + a] > lost[radius + b]; });
+	for( auto i = 0; left > 0; i++, left -= 2 ) {
+		k.weights[radius - sides[i]]++;
+		k.weights[radius + sides[i]]++;
+	}
+	return k;
+}
+
+std::uint8_t rounded(const std::int32_t sum) {
+	return static_cast<std::uint8_t>(std::clamp((sum + (1 << (blur_kernel::bits - 1))) >> blur_kernel::bits, 0, 255));
+}
+
+/*!
+ * @brief Convolve each row of a band with the kernel
+ */
+void rows_pass(const mutable_image_view &image, const blur_kernel &k, const int first, const int last) {
+	const auto width = image.size().width();
+	const auto bytes = static_cast<std::size_t>(width) * 3;
+	auto padded = std::vector<std::uint8_t>((static_cast<std::size_t>(width) + 2 * k.radius) * 3);
+	auto sums = std::vector<std::int32_t>(bytes);
+	for( auto y = first; y < last; y++ ) {
+		auto *row = reinterpret_cast<std::uint8_t *>(image[y].data());
+
+		// Copy the row with its edge pixels repeated out to the radius, so the sums need no bounds checks
+		for( auto x = 0; x < k.radius; x++ ) {
+			std::memcpy(&padded[static_cast<std::size_t>(x) * 3], row, 3);
+			std::memcpy(&padded[(static_cast<std::size_t>(width) + k.radius + x) * 3], row + bytes - 3, 3);
+		}
+		std::memcpy(&padded[static_cast<std::size_t>(k.radius) * 3], row, bytes);
+
+		std::fill(sums.begin(), sums.end(), 0);
+		for( std::size_t tap = 0; tap < k.weights.size(); tap++ ) {
+			const auto *in = &padded[tap * 3];
+			const auto w = k.weights[tap];
+			for( std::size_t c = 0; c < bytes; c++ ) { sums[c] += static_cast<std::int16_t>(in[c]) * w; }
+		}
+		for( std::size_t c = 0; c < bytes; c++ ) { row[c] = rounded(sums[c]); }
+	}
+}
+
+/*!
+ * @brief Convolve the columns of a band with the kernel, in place.
+ * A ring of the last 2 * radius + 1 rows read keeps the values that the rows above have been overwritten with.
+ * @param above The radius rows before the band as they were before any band was changed
+ * @param below The radius rows after the band, likewise
+ */
+void columns_pass(const mutable_image_view &image, const blur_kernel &k, const int first, const int last,
+				  const std::vector<std::uint8_t> &above, const std::vector<std::uint8_t> &below) {
+	const auto height = image.size().height();
+	const auto bytes = static_cast<std::size_t>(image.size().width()) * 3;
+	const auto taps = k.weights.size();
+	const auto strip = std::min(bytes, std::max<std::size_t>(64, strip_budget / taps / 64 * 64));
+
+	// Where row i, which may be off the edge or outside the band, was before anything changed
+	const auto original = [&](const int i, const std::size_t offset) {
+		const auto j = std::clamp(i, 0, height - 1);
+		if( j < first ) { return &above[static_cast<std::size_t>(j - (first - k.radius)) * bytes + offset]; }
+		if( j >= last ) { return &below[static_cast<std::size_t>(j - last) * bytes + offset]; }
+		return reinterpret_cast<const std::uint8_t *>(image[j].data()) + offset;
+	};
+
+	auto ring = std::vector<std::uint8_t>(taps * strip);
+	auto sums = std::vector<std::int32_t>(strip);
+	for( std::size_t offset = 0; offset < bytes; offset += strip ) {
+		const auto n = std::min(strip, bytes - offset);
+		const auto slot = [&](const int i) { return &ring[static_cast<std::size_t>(i - first + k.radius) % taps * strip]; };
+		for( auto i = first - k.radius; i < first + k.radius; i++ ) { std::memcpy(slot(i), original(i, offset), n); }
+
+		for( auto y = first; y < last; y++ ) {
+			// Row y + radius hasn't been written yet, so it can be read from where it is
+			std::memcpy(slot(y + k.radius), original(y + k.radius, offset), n);
+			std::fill_n(sums.begin(), n, 0);
+			for( std::size_t tap = 0; tap < taps; tap++ ) {
+				const auto *in = slot(y - k.radius + static_cast<int>(tap));
+				const auto w = k.weights[tap];
+				for( std::size_t c = 0; c < n; c++ ) { sums[c] += static_cast<std::int16_t>(in[c]) * w; }
+			}
+			auto *out = reinterpret_cast<std::uint8_t *>(image[y].data()) + offset;
+			for( std::size_t c = 0; c < n; c++ ) { out[c] = rounded(sums[c]); }
+		}
+	}
+}
+
+}
+
+blur_kernel gaussian_kernel(const double sigma) {
+	const auto radius = std::max(1, static_cast<int>(std::ceil(3 * sigma)));
+	auto weights = std::vector<double>{};
+	for( auto x = -radius; x <= radius; x++ ) {
+		weights.push_back(sigma > 0 ? std::exp(-x * x / (2 * sigma * sigma)) : x == 0);
+	}
+	return normalised(radius, weights);
+}
+
+blur_kernel box_kernel(const int radius) {
+	const auto r = std::max(0, radius);
+	return normalised(r, std::vector<double>(static_cast<std::size_t>(2 * r + 1), 1.0));
+}
+
+void convolve(const mutable_image_view &image, const blur_kernel &k, const unsigned threads) {
+	static_assert(sizeof(rgb_pixel) == 3, "Rows of pixels are convolved as runs of bytes");
+	if( image.empty() || k.weights.empty()) { return; }
+
+	const auto height = image.size().height();
+	parallel_bands(height, threads, [&](const int first, const int last, int) { rows_pass(image, k, first, last); });
+
+	// Each band overwrites its rows while the bands either side still need to read them,
+	// so keep a copy of the rows around each boundary as they were
+	const auto bands = band_count(height, threads);
+	const auto bytes = static_cast<std::size_t>(image.size().width()) * 3;
+	auto above = std::vector<std::vector<std::uint8_t>>(static_cast<std::size_t>(bands));
+	auto below = std::vector<std::vector<std::uint8_t>>(static_cast<std::size_t>(bands));
+	for( auto b = 0; b < bands; b++ ) {
+		const auto first = band_start(height, bands, b);
+		const auto last = band_start(height, bands, b + 1);
+		const auto copy = [&](std::vector<std::uint8_t> &rows, const int from) {
+			rows.resize(static_cast<std::size_t>(k.radius) * bytes);
+			for( auto i = 0; i < k.radius; i++ ) {
+				const auto j = std::clamp(from + i, 0, height - 1);
+				std::memcpy(&rows[static_cast<std::size_t>(i) * bytes], image[j].data(), bytes);
+			}
+		};
+		copy(above[b], first - k.radius);
+		copy(below[b], last);
+	}
+
+	parallel_bands(height, threads, [&](const int first, const int last, const int band) {
+		columns_pass(image, k, first, last, above[band], below[band]);
+	});
+}
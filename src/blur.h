@@ -0,0 +1,45 @@
+#ifndef SONGSIM_BLUR_H
+#define SONGSIM_BLUR_H
+
+#include <cstdint>
+#include <vector>
+#include "ppm_file.h"
+
+/*!
+ * @brief A symmetric one dimensional kernel, applied along the rows and then down the columns
+ */
+struct blur_kernel {
+	int radius{0};
+	/*! The 2 * radius + 1 weights, in fixed point adding up to exactly 1 << blur_kernel::bits */
+	std::vector<std::int16_t> weights;
+
+	static constexpr int bits = 14;
+};
+
+/*!
+ * @brief A Gaussian kernel, reaching out to three standard deviations
+ * @param sigma The standard deviation in pixels
+ * @throw std::runtime_error if it has more weights than the fixed point has units, sigma over 2730
+ */
+blur_kernel gaussian_kernel(double sigma);
+
+/*!
+ * @brief A kernel averaging the 2 * radius + 1 pixels around each one
+ * @param radius How far either side to reach
+ * @throw std::runtime_error if it has more weights than the fixed point has units, radius 8192 and up
+ */
+blur_kernel box_kernel(int radius);
+
+/*!
+ * @brief Convolve an image with a kernel in place, along the rows and then down the columns.
+ * Pixels beyond the edges are taken to be the same as the ones at the edge.
+ * It works in fixed point on the 8 bit channels and never copies more than a few rows, so it works on
+ * images too big to have a second copy of. The rows are split into a band for each thread, and
+ * the columns pass goes down strips of the band narrow enough to stay in the cache.
+ * @param image The pixels to convolve
+ * @param k The kernel
+ * @param threads How many threads to use, 0 means one per hardware thread
+ */
+void convolve(const mutable_image_view& image, const blur_kernel& k, unsigned threads = 1);
+
+#endif //SONGSIM_BLUR_H
@@ -0,0 +1,26 @@
+#include "counting_resource.h"
+
+void counting_resource::reset() {
+	_allocations = 0;
+	_bytes = 0;
+	_high_water = _in_use.load();
+}
+
+void *counting_resource::do_allocate(const std::size_t bytes, const std::size_t alignment) {
+	void *p = _upstream->allocate(bytes, alignment);
+	_allocations++;
+	_bytes += bytes;
+	const auto now = _in_use += bytes;
+	auto high = _high_water.load();
+	while( now > high && !_high_water.compare_exchange_weak(high, now)) { /*! Try again with the new high */ }
+	return p;
+}
+
+void counting_resource::do_deallocate(void *p, const std::size_t bytes, const std::size_t alignment) {
+	_upstream->deallocate(p, bytes, alignment);
+	_in_use -= bytes;
+}
+
+bool counting_resource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+	return this == &other;
+}
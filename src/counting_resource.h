@@ -0,0 +1,60 @@
+#ifndef SONGSIM_COUNTING_RESOURCE_H
+#define SONGSIM_COUNTING_RESOURCE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+/*!
+ * @brief A memory resource which counts what's allocated through it, passing the allocations on to another.
+ * Give it to a ppm_image, or make it the default resource, to see what an image costs.
+ * It's safe to allocate from more than one thread at once.
+ */
+class counting_resource : public std::pmr::memory_resource {
+public:
+	/*!
+	 * @param upstream Where the memory really comes from
+	 */
+	explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: _upstream(upstream)
+	{ /*! Intentionally Blank */ }
+
+	/*!
+	 * @brief Accessor
+	 * @return How many allocations have been made
+	 */
+	std::size_t allocations() const 	{ return _allocations; }
+	/*!
+	 * @brief Accessor
+	 * @return How many bytes have been allocated in total, including any since freed
+	 */
+	std::size_t bytes() const 			{ return _bytes; }
+	/*!
+	 * @brief Accessor
+	 * @return How many bytes are allocated right now
+	 */
+	std::size_t in_use() const 			{ return _in_use; }
+	/*!
+	 * @brief Accessor
+	 * @return The most bytes that have been allocated at once
+	 */
+	std::size_t high_water() const 		{ return _high_water; }
+
+	/*!
+	 * @brief Start counting again from now. Whatever is in use now counts towards the high water mark.
+	 */
+	void reset();
+
+private:
+	std::pmr::memory_resource* 	_upstream;
+	std::atomic<std::size_t> 	_allocations{0};
+	std::atomic<std::size_t> 	_bytes{0};
+	std::atomic<std::size_t> 	_in_use{0};
+	std::atomic<std::size_t> 	_high_water{0};
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+#endif //SONGSIM_COUNTING_RESOURCE_H
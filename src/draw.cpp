@@ -0,0 +1,76 @@
+#include "draw.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+static_assert(sizeof(rgb_pixel) == 3, "Rows of pixels are copied as bytes");
+
+/*!
+ * @brief Set a run of pixels to one colour
+ * @param p The first pixel
+ * @param count How many pixels
+ * @param colour The colour
+ */
+void fill_pixels(rgb_pixel *p, const std::size_t count, const rgb_pixel &colour) {
+	if( count == 0 ) { return; }
+	if( colour.red() == colour.green() && colour.green() == colour.blue()) {
+		std::fill_n(reinterpret_cast<std::uint8_t *>(p), count * sizeof(rgb_pixel), colour.red());
+		return;
+	}
+
+	// Three byte pixels don't fit a register, so set a few and then copy what's been set forwards,
+	// doubling each time but no more than stays in the L1 cache
+	constexpr auto most = std::size_t{4096 / sizeof(rgb_pixel)};
+	auto done = std::min<std::size_t>(count, 16);
+	std::fill_n(p, done, colour);
+	while( done < count ) {
+		const auto n = std::min({done, count - done, most});
+		std::memcpy(p + done, p, n * sizeof(rgb_pixel));
+		done += n;
+	}
+}
+
+}
+
+void fill_rect(const mutable_image_view &dst, const image_rect &r, const rgb_pixel &colour) {
+	fill(dst.crop(r), colour);
+}
+
+void fill(const mutable_image_view &dst, const rgb_pixel &colour) {
+	if( dst.empty()) { return; }
+	const auto width = static_cast<std::size_t>(dst.size().width());
+	if( dst.contiguous()) {
+		fill_pixels(dst.data(), width * static_cast<std::size_t>(dst.size().height()), colour);
+		return;
+	}
+
+	// Set the first row, then copy it to the others
+	fill_pixels(dst.data(), width, colour);
+	for( auto row = 1; row < dst.size().height(); row++ ) {
+		std::memcpy(dst[row].data(), dst.data(), width * sizeof(rgb_pixel));
+	}
+}
+
+void blit(const image_view &src, const mutable_image_view &dst, const int x, const int y) {
+	// Clip to dst, then take the same part of src
+	const auto target = dst.crop({x, y, src.size().width(), src.size().height()});
+	if( target.empty()) { return; }
+	const auto source = src.crop({std::max(0, -x), std::max(0, -y), target.size().width(), target.size().height()});
+	const auto bytes = static_cast<std::size_t>(target.size().width()) * sizeof(rgb_pixel);
+	const auto rows = target.size().height();
+
+	if( source.contiguous() && target.contiguous()) {
+		std::memmove(target.data(), source.data(), bytes * static_cast<std::size_t>(rows));
+		return;
+	}
+	// When moving pixels further on in the same image, the last rows have to move first
+	// so nothing is overwritten before it's been copied
+	const auto backwards = target.data() > source.data() ||
+						   (target.data() == source.data() && target.stride() > source.stride());
+	for( auto i = 0; i < rows; i++ ) {
+		const auto row = backwards ? rows - 1 - i : i;
+		std::memmove(target[row].data(), source[row].data(), bytes);
+	}
+}
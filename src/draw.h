@@ -0,0 +1,32 @@
+#ifndef SONGSIM_DRAW_H
+#define SONGSIM_DRAW_H
+
+#include "ppm_file.h"
+
+/*!
+ * @brief Set every pixel in a rectangle to one colour, a row at a time rather than a pixel at a time
+ * @param dst The image to draw on
+ * @param r The rectangle, clipped to dst
+ * @param colour The colour
+ */
+void fill_rect(const mutable_image_view& dst, const image_rect& r, const rgb_pixel& colour);
+
+/*!
+ * @brief Set every pixel of a view to one colour
+ * @param dst The pixels to set
+ * @param colour The colour
+ */
+void fill(const mutable_image_view& dst, const rgb_pixel& colour);
+
+/*!
+ * @brief Copy the pixels of one view onto another, a row at a time.
+ * The views may be of the same pixels, as long as the copy moves them one way: either further on in memory
+ * with the stride the same or wider, or further back with it the same or narrower.
+ * @param src The pixels to copy
+ * @param dst Where to copy them to
+ * @param x The column of dst to put the left of src at, the copy is clipped to dst
+ * @param y The row of dst to put the top of src at
+ */
+void blit(const image_view& src, const mutable_image_view& dst, int x, int y);
+
+#endif //SONGSIM_DRAW_H
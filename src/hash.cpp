@@ -0,0 +1,113 @@
+#include "hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr auto prime1 = std::uint64_t{11400714785074694791ULL};
+constexpr auto prime2 = std::uint64_t{14029467366897019727ULL};
+constexpr auto prime3 = std::uint64_t{1609587929392839161ULL};
+constexpr auto prime4 = std::uint64_t{9650029242287828579ULL};
+constexpr auto prime5 = std::uint64_t{2870177450012600261ULL};
+
+std::uint64_t rotl(const std::uint64_t x, const int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+/*!
+ * @brief Read little endian whatever the machine is, so the hash is the same everywhere
+ */
+template<typename T>
+T read_le(const unsigned char *p) {
+	auto v = T{0};
+	for( std::size_t i = 0; i < sizeof(T); i++ ) { v |= static_cast<T>(p[i]) << (8 * i); }
+	return v;
+}
+
+std::uint64_t lane_round(std::uint64_t lane, const std::uint64_t input) {
+	lane += input * prime2;
+	return rotl(lane, 31) * prime1;
+}
+
+std::uint64_t merge(std::uint64_t h, const std::uint64_t lane) {
+	h ^= lane_round(0, lane);
+	return h * prime1 + prime4;
+}
+
+void stripe(std::array<std::uint64_t, 4> &lanes, const unsigned char *p) {
+	for( auto i = 0; i < 4; i++ ) { lanes[i] = lane_round(lanes[i], read_le<std::uint64_t>(p + 8 * i)); }
+}
+
+}
+
+xxh64::xxh64(const std::uint64_t seed)
+		: _seed(seed), _lanes{seed + prime1 + prime2, seed + prime2, seed, seed - prime1} {}
+
+void xxh64::update(const void *data, std::size_t length) {
+	auto p = static_cast<const unsigned char *>(data);
+	_length += length;
+
+	// Finish a stripe left over from last time first
+	if( _buffered ) {
+		const auto take = std::min(length, _buffer.size() - _buffered);
+		std::memcpy(_buffer.data() + _buffered, p, take);
+		_buffered += take;
+		p += take;
+		length -= take;
+		if( _buffered < _buffer.size()) { return; }
+		stripe(_lanes, _buffer.data());
+		_buffered = 0;
+	}
+	for( ; length >= 32; p += 32, length -= 32 ) { stripe(_lanes, p); }
+	std::memcpy(_buffer.data(), p, length);
+	_buffered = length;
+}
+
+std::uint64_t xxh64::digest() const {
+	auto h = std::uint64_t{0};
+	if( _length >= 32 ) {
+		h = rotl(_lanes[0], 1) + rotl(_lanes[1], 7) + rotl(_lanes[2], 12) + rotl(_lanes[3], 18);
+		for( const auto lane: _lanes ) { h = merge(h, lane); }
+	}
+	else {
+		h = _seed + prime5;
+	}
+	h += _length;
+
+	const auto *p = _buffer.data();
+	auto left = _buffered;
+	for( ; left >= 8; p += 8, left -= 8 ) {
+		h ^= lane_round(0, read_le<std::uint64_t>(p));
+		h = rotl(h, 27) * prime1 + prime4;
+	}
+	if( left >= 4 ) {
+		h ^= read_le<std::uint32_t>(p) * prime1;
+		h = rotl(h, 23) * prime2 + prime3;
+		p += 4;
+		left -= 4;
+	}
+	for( ; left > 0; p++, left-- ) {
+		h ^= *p * prime5;
+		h = rotl(h, 11) * prime1;
+	}
+
+	h ^= h >> 33;
+	h *= prime2;
+	h ^= h >> 29;
+	h *= prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+std::uint64_t xxh64_hash(const void *data, const std::size_t length, const std::uint64_t seed) {
+	auto h = xxh64{seed};
+	h.update(data, length);
+	return h.digest();
+}
+
+std::string hash_hex(const std::uint64_t hash) {
+	constexpr auto digits = "0123456789abcdef";
+	auto hex = std::string(16, '0');
+	for( auto i = 0; i < 16; i++ ) { hex[15 - i] = digits[(hash >> (4 * i)) & 0xf]; }
+	return hex;
+}
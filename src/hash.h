@@ -0,0 +1,46 @@
+#ifndef SONGSIM_HASH_H
+#define SONGSIM_HASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*!
+ * @brief The XXH64 hash, fed a piece at a time.
+ * It's fast and stable across runs and machines, for telling whether two things are the same,
+ * but not cryptographic.
+ */
+class xxh64 {
+public:
+	explicit xxh64(std::uint64_t seed = 0);
+
+	/*!
+	 * @brief Add some bytes, which hash the same however they're split up between calls
+	 */
+	void update(const void* data, std::size_t length);
+
+	/*!
+	 * @brief The hash of everything added so far, which can carry on being added to
+	 */
+	std::uint64_t digest() const;
+
+private:
+	std::uint64_t 					_seed;
+	std::array<std::uint64_t, 4> 	_lanes;
+	std::array<unsigned char, 32> 	_buffer{};	/*! What's been added since the last full stripe 	*/
+	std::size_t 					_buffered{0};
+	std::uint64_t 					_length{0};	/*! Bytes added in total 							*/
+};
+
+/*!
+ * @brief The XXH64 hash of some bytes
+ */
+std::uint64_t xxh64_hash(const void* data, std::size_t length, std::uint64_t seed = 0);
+
+/*!
+ * @brief A hash as 16 hex digits
+ */
+std::string hash_hex(std::uint64_t hash);
+
+#endif //SONGSIM_HASH_H
@@ -0,0 +1,97 @@
+#include "image_compare.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/*!
+ * @brief What one band of rows adds to the difference
+ */
+struct band_difference {
+	std::uint64_t 	differing{0};
+	int 			max_delta{0};
+	std::uint64_t 	squares{0};
+};
+
+void compare_band(const image_view &a, const image_view &b, const mutable_image_view *diff, const int first,
+				  const int last, band_difference &out) {
+	const auto width = static_cast<std::size_t>(a.size().width());
+	const auto bytes = width * 3;
+	for( auto y = first; y < last; y++ ) {
+		const auto *left = reinterpret_cast<const std::uint8_t *>(a[y].data());
+		const auto *right = reinterpret_cast<const std::uint8_t *>(b[y].data());
+		if( std::memcmp(left, right, bytes) == 0 ) {
+			if( diff ) { std::fill_n((*diff)[y].data(), width, rgb_pixel{0, 0, 0}); }
+			continue;
+		}
+
+		auto *drawn = diff ? reinterpret_cast<std::uint8_t *>((*diff)[y].data()) : nullptr;
+		auto squares = std::uint64_t{0};
+		for( std::size_t x = 0; x < width; x++ ) {
+			auto any = 0;
+			for( std::size_t c = x * 3; c < x * 3 + 3; c++ ) {
+				const auto delta = std::abs(left[c] - right[c]);
+				any |= delta;
+				out.max_delta = std::max(out.max_delta, delta);
+				squares += static_cast<std::uint64_t>(delta * delta);
+				if( drawn ) { drawn[c] = static_cast<std::uint8_t>(delta); }
+			}
+			out.differing += any != 0;
+		}
+		out.squares += squares;
+	}
+}
+
+image_difference compare(const image_view &a, const image_view &b, const mutable_image_view *diff,
+						 const unsigned threads) {
+	static_assert(sizeof(rgb_pixel) == 3, "Rows of pixels are compared as runs of bytes");
+	if( a.size() != b.size() || (diff && diff->size() != a.size())) {
+		throw std::runtime_error("Only images of the same size can be compared");
+	}
+	auto result = image_difference{};
+	result.pixels = static_cast<std::uint64_t>(std::max(a.size().width(), 0)) *
+					static_cast<std::uint64_t>(std::max(a.size().height(), 0));
+
+	if( !a.empty()) {
+		const auto height = a.size().height();
+		auto bands = std::vector<band_difference>(static_cast<std::size_t>(band_count(height, threads)));
+		parallel_bands(height, threads, [&](const int first, const int last, const int band) {
+			compare_band(a, b, diff, first, last, bands[band]);
+		});
+		auto squares = std::uint64_t{0};
+		for( const auto &band: bands ) {
+			result.differing += band.differing;
+			result.max_delta = std::max(result.max_delta, band.max_delta);
+			squares += band.squares;
+		}
+		result.mse = static_cast<double>(squares) / (static_cast<double>(result.pixels) * 3);
+	}
+	result.psnr = result.mse > 0 ? 10 * std::log10(UINT8_MAX * UINT8_MAX / result.mse)
+								 : std::numeric_limits<double>::infinity();
+	return result;
+}
+
+}
+
+bool images_equal(const image_view &a, const image_view &b) {
+	if( a.size() != b.size()) { return false; }
+	const auto bytes = static_cast<std::size_t>(std::max(a.size().width(), 0)) * sizeof(rgb_pixel);
+	for( auto y = 0; y < a.size().height(); y++ ) {
+		if( std::memcmp(a[y].data(), b[y].data(), bytes) != 0 ) { return false; }
+	}
+	return true;
+}
+
+image_difference compare_images(const image_view &a, const image_view &b, const unsigned threads) {
+	return compare(a, b, nullptr, threads);
+}
+
+image_difference compare_images(const image_view &a, const image_view &b, const mutable_image_view &diff,
+								const unsigned threads) {
+	return compare(a, b, &diff, threads);
+}
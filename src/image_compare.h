@@ -0,0 +1,50 @@
+#ifndef SONGSIM_IMAGE_COMPARE_H
+#define SONGSIM_IMAGE_COMPARE_H
+
+#include <cstdint>
+#include "ppm_file.h"
+
+/*!
+ * @brief How two images of the same size differ
+ */
+struct image_difference {
+	std::uint64_t 	pixels{0};		/*! Pixels compared 									*/
+	std::uint64_t 	differing{0};	/*! Pixels with any channel different 					*/
+	int 			max_delta{0};	/*! The biggest difference in any channel 				*/
+	double 			mse{0};			/*! The mean of the squared differences of the channels 	*/
+	double 			psnr{0};		/*! Peak signal to noise ratio in dB, infinite if the same 	*/
+
+	bool same() const { return differing == 0; }
+};
+
+/*!
+ * @brief Whether two images are the same size with the same pixels.
+ * Rows are compared with memcmp and it stops at the first which differs.
+ * @param a One image, which can be a view of a mapped_ppm as well as of a ppm_image
+ * @param b The other
+ */
+bool images_equal(const image_view& a, const image_view& b);
+
+/*!
+ * @brief Measure how two images differ, over bands of rows on their own threads.
+ * Rows are first compared with memcmp, so only the ones which differ are gone through a pixel at a time.
+ * With a mapped_ppm only the pages being compared need to be in memory.
+ * @param a One image
+ * @param b The other, which must be the same size
+ * @param threads How many threads to use, 0 means one per hardware thread
+ * @throw std::runtime_error if they aren't the same size
+ */
+image_difference compare_images(const image_view& a, const image_view& b, unsigned threads = 1);
+
+/*!
+ * @brief Measure how two images differ, and draw the differences
+ * @param a One image
+ * @param b The other, which must be the same size
+ * @param diff Set to the absolute difference of each channel, black where they're the same. It must be the same size.
+ * @param threads How many threads to use, 0 means one per hardware thread
+ * @throw std::runtime_error if they aren't all the same size
+ */
+image_difference compare_images(const image_view& a, const image_view& b, const mutable_image_view& diff,
+								unsigned threads = 1);
+
+#endif //SONGSIM_IMAGE_COMPARE_H
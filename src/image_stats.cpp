@@ -0,0 +1,108 @@
+#include "image_stats.h"
+#include "parallel.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/*! How many histograms each channel is counted into */
+constexpr auto ways = 4;
+
+/*!
+ * @brief The counts for one band of rows
+ */
+struct band_counts {
+	std::array<std::array<std::array<std::uint64_t, 256>, ways>, 3> histograms{};
+	std::uint64_t foreground{0};
+};
+
+void count_band(const image_view &image, const rgb_pixel &background, const int first, const int last,
+				band_counts &counts) {
+	auto &[reds, greens, blues] = counts.histograms;
+	const auto width = static_cast<std::size_t>(image.size().width());
+	auto foreground = std::uint64_t{0};
+	for( auto y = first; y < last; y++ ) {
+		const auto *row = reinterpret_cast<const std::uint8_t *>(image[y].data());
+		auto x = std::size_t{0};
+		for( ; x + ways <= width; x += ways ) {
+			// Read the pixels before counting any, as a count could be stored over them as far as the compiler knows
+			auto values = std::array<std::uint8_t, ways * 3>{};
+			std::copy_n(row + x * 3, values.size(), values.begin());
+			for( auto w = 0; w < ways; w++ ) {
+				reds[w][values[w * 3]]++;
+				greens[w][values[w * 3 + 1]]++;
+				blues[w][values[w * 3 + 2]]++;
+			}
+		}
+		for( ; x < width; x++ ) {
+			const auto *p = row + x * 3;
+			reds[0][p[0]]++;
+			greens[0][p[1]]++;
+			blues[0][p[2]]++;
+		}
+		for( const auto &p: image[y] ) { foreground += p != background; }
+	}
+	counts.foreground = foreground;
+}
+
+}
+
+image_stats measure(const image_view &image, const rgb_pixel &background, const unsigned threads) {
+	static_assert(sizeof(rgb_pixel) == 3, "Pixels are counted as runs of bytes");
+	auto stats = image_stats{};
+	if( image.empty()) { return stats; }
+
+	const auto height = image.size().height();
+	auto bands = std::vector<band_counts>(static_cast<std::size_t>(band_count(height, threads)));
+	parallel_bands(height, threads, [&](const int first, const int last, const int band) {
+		count_band(image, background, first, last, bands[band]);
+	});
+
+	for( const auto &b: bands ) {
+		for( auto c = 0; c < 3; c++ ) {
+			for( const auto &h: b.histograms[c] ) {
+				for( auto v = 0; v < 256; v++ ) { stats.histogram[c][v] += h[v]; }
+			}
+		}
+		stats.foreground += b.foreground;
+	}
+	stats.pixels = static_cast<std::uint64_t>(image.size().width()) * static_cast<std::uint64_t>(height);
+
+	auto lows = std::array<std::uint8_t, 3>{};
+	auto highs = std::array<std::uint8_t, 3>{};
+	for( auto c = 0; c < 3; c++ ) {
+		const auto &h = stats.histogram[c];
+		auto total = 0.0;
+		auto low = 255, high = 0;
+		for( auto v = 0; v < 256; v++ ) {
+			if( !h[v] ) { continue; }
+			low = std::min(low, v);
+			high = v;
+			total += static_cast<double>(h[v]) * v;
+		}
+		lows[c] = static_cast<std::uint8_t>(low);
+		highs[c] = static_cast<std::uint8_t>(high);
+		stats.mean[c] = total / static_cast<double>(stats.pixels);
+	}
+	stats.min = rgb_pixel{lows[0], lows[1], lows[2]};
+	stats.max = rgb_pixel{highs[0], highs[1], highs[2]};
+	return stats;
+}
+
+void image_stats::write_json(std::ostream &os) const {
+	const auto channel = [&](const rgb_pixel &p) {
+		os << "[" << +p.red() << ", " << +p.green() << ", " << +p.blue() << "]";
+	};
+	os << "{\"pixels\": " << pixels << ", \"foreground\": " << foreground << ", \"min\": ";
+	channel(min);
+	os << ", \"max\": ";
+	channel(max);
+	os << ", \"mean\": [" << mean[0] << ", " << mean[1] << ", " << mean[2] << "], \"histogram\": {";
+	const char *names[] = {"red", "green", "blue"};
+	for( auto c = 0; c < 3; c++ ) {
+		os << (c ? ", " : "") << "\"" << names[c] << "\": [";
+		for( auto v = 0; v < 256; v++ ) { os << (v ? ", " : "") << histogram[c][v]; }
+		os << "]";
+	}
+	os << "}}" << std::endl;
+}
@@ -0,0 +1,38 @@
+#ifndef SONGSIM_IMAGE_STATS_H
+#define SONGSIM_IMAGE_STATS_H
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include "ppm_file.h"
+
+/*!
+ * @brief A summary of the pixels of an image
+ */
+struct image_stats {
+	/*! How many pixels have each value of red, green and blue, in that order */
+	std::array<std::array<std::uint64_t, 256>, 3> 	histogram{};
+	std::uint64_t 									pixels{0};		/*! Pixels looked at 							*/
+	std::uint64_t 									foreground{0};	/*! Pixels which aren't the background colour 	*/
+	rgb_pixel 										min;			/*! The lowest value of each channel 			*/
+	rgb_pixel 										max;			/*! The highest value of each channel 			*/
+	std::array<double, 3> 							mean{};			/*! The mean value of each channel 				*/
+
+	/*!
+	 * @brief Write the summary as one JSON object, the histograms as arrays of 256 counts
+	 */
+	void write_json(std::ostream& os) const;
+};
+
+/*!
+ * @brief Summarise an image in a single pass over its pixels.
+ * Each band of rows is counted on its own thread into four histograms per channel, taking pixels in turn,
+ * so runs of the same colour don't each wait for the last count to be stored before adding to it.
+ * The minimum, maximum and mean are worked out from the histograms afterwards.
+ * @param image The pixels, which can be a view of a mapped_ppm as well as of a ppm_image
+ * @param background The colour which isn't counted as foreground
+ * @param threads How many threads to use, 0 means one per hardware thread
+ */
+image_stats measure(const image_view& image, const rgb_pixel& background, unsigned threads = 1);
+
+#endif //SONGSIM_IMAGE_STATS_H
@@ -0,0 +1,144 @@
+#include "lut.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX512VBMI__) && defined(__AVX512BW__)
+#define SONGSIM_LUT_VBMI 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+channel_lut curve(const std::uint8_t max_colour, double (*f)(double, double), const double parameter) {
+	auto lut = identity_lut();
+	for( auto v = 0; v <= max_colour; v++ ) {
+		const auto out = max_colour * f(static_cast<double>(v) / std::max<int>(max_colour, 1), parameter);
+		lut[v] = static_cast<std::uint8_t>(std::clamp(std::lround(out), 0L, static_cast<long>(max_colour)));
+	}
+	return lut;
+}
+
+#ifdef SONGSIM_LUT_VBMI
+
+/*!
+ * @brief A table held as four vectors of 64 entries, so 64 values can be looked up at once
+ */
+class vector_lut {
+public:
+	explicit vector_lut(const channel_lut &lut) {
+		for( auto q = 0; q < 4; q++ ) { _quarters[q] = _mm512_loadu_si512(lut.data() + 64 * q); }
+	}
+
+	__m512i lookup(const __m512i values) const {
+		// The low seven bits of each value pick from a pair of quarters, the top bit which pair
+		const auto low = _mm512_permutex2var_epi8(_quarters[0], values, _quarters[1]);
+		const auto high = _mm512_permutex2var_epi8(_quarters[2], values, _quarters[3]);
+		return _mm512_mask_blend_epi8(_mm512_movepi8_mask(values), low, high);
+	}
+
+private:
+	__m512i _quarters[4];
+};
+
+/*!
+ * @brief Which bytes of 64 are green and which are blue, for each channel the first byte can be
+ */
+struct channel_masks {
+	__mmask64 green[3]{};
+	__mmask64 blue[3]{};
+
+	channel_masks() {
+		for( auto phase = 0; phase < 3; phase++ ) {
+			for( auto i = 0; i < 64; i++ ) {
+				const auto bit = __mmask64{1} << i;
+				if((phase + i) % 3 == 1 ) { green[phase] |= bit; }
+				if((phase + i) % 3 == 2 ) { blue[phase] |= bit; }
+			}
+		}
+	}
+};
+
+#endif
+
+void lookup_rows(const mutable_image_view &image, const channel_lut &red, const channel_lut &green,
+				 const channel_lut &blue, const int first, const int last) {
+	const auto bytes = static_cast<std::size_t>(image.size().width()) * 3;
+	const auto same = red == green && green == blue;
+#ifdef SONGSIM_LUT_VBMI
+	const channel_lut *tables[] = {&red, &green, &blue};
+	const auto vectors = std::array<vector_lut, 3>{vector_lut{red}, vector_lut{green}, vector_lut{blue}};
+	const auto masks = channel_masks{};
+#endif
+
+	for( auto y = first; y < last; y++ ) {
+		auto *row = reinterpret_cast<std::uint8_t *>(image[y].data());
+#ifdef SONGSIM_LUT_VBMI
+		auto i = std::size_t{0};
+		for( ; i + 64 <= bytes; i += 64 ) {
+			const auto values = _mm512_loadu_si512(row + i);
+			auto out = vectors[0].lookup(values);
+			if( !same ) {
+				// 64 isn't a multiple of 3, so which channel each byte is moves on with each vector
+				const auto phase = i % 3;
+				out = _mm512_mask_blend_epi8(masks.green[phase], out, vectors[1].lookup(values));
+				out = _mm512_mask_blend_epi8(masks.blue[phase], out, vectors[2].lookup(values));
+			}
+			_mm512_storeu_si512(row + i, out);
+		}
+		for( ; i < bytes; i++ ) { row[i] = (*tables[i % 3])[row[i]]; }
+#else
+		if( same ) {
+			for( std::size_t i = 0; i < bytes; i++ ) { row[i] = red[row[i]]; }
+		}
+		else {
+			for( std::size_t i = 0; i < bytes; i += 3 ) {
+				row[i] = red[row[i]];
+				row[i + 1] = green[row[i + 1]];
+				row[i + 2] = blue[row[i + 2]];
+			}
+		}
+#endif
+	}
+}
+
+}
+
+channel_lut identity_lut() {
+	auto lut = channel_lut{};
+	for( auto v = 0; v < 256; v++ ) { lut[v] = static_cast<std::uint8_t>(v); }
+	return lut;
+}
+
+channel_lut gamma_lut(const double gamma, const std::uint8_t max_colour) {
+	return curve(max_colour, [](const double v, const double g) { return std::pow(v, g); }, gamma);
+}
+
+channel_lut contrast_lut(const double contrast, const std::uint8_t max_colour) {
+	return curve(max_colour, [](const double v, const double c) { return (v - 0.5) * c + 0.5; }, contrast);
+}
+
+channel_lut brightness_lut(const int offset, const std::uint8_t max_colour) {
+	auto lut = identity_lut();
+	for( auto v = 0; v <= max_colour; v++ ) { lut[v] = static_cast<std::uint8_t>(std::clamp(v + offset, 0, +max_colour)); }
+	return lut;
+}
+
+channel_lut combine(const channel_lut &first, const channel_lut &second) {
+	auto lut = channel_lut{};
+	for( auto v = 0; v < 256; v++ ) { lut[v] = second[first[v]]; }
+	return lut;
+}
+
+void apply_lut(const mutable_image_view &image, const channel_lut &red, const channel_lut &green,
+			   const channel_lut &blue, const unsigned threads) {
+	static_assert(sizeof(rgb_pixel) == 3, "Rows of pixels are looked up as runs of bytes");
+	if( image.empty()) { return; }
+	parallel_bands(image.size().height(), threads, [&](const int first, const int last, int) {
+		lookup_rows(image, red, green, blue, first, last);
+	});
+}
+
+void apply_lut(const mutable_image_view &image, const channel_lut &lut, const unsigned threads) {
+	apply_lut(image, lut, lut, lut, threads);
+}
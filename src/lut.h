@@ -0,0 +1,67 @@
+#ifndef SONGSIM_LUT_H
+#define SONGSIM_LUT_H
+
+#include <array>
+#include <cstdint>
+#include "ppm_file.h"
+
+/*!
+ * @brief The new value for each old value of a channel
+ */
+using channel_lut = std::array<std::uint8_t, 256>;
+
+/*!
+ * @brief A table which leaves every value as it is
+ */
+channel_lut identity_lut();
+
+/*!
+ * @brief A power curve, max_colour * (value / max_colour) ^ gamma
+ * @param gamma Above one darkens the mid tones, below one lightens them
+ * @param max_colour The value which is full brightness, the image's max colour value
+ */
+channel_lut gamma_lut(double gamma, std::uint8_t max_colour = UINT8_MAX);
+
+/*!
+ * @brief Stretch the values away from the middle of the range, or squash them towards it
+ * @param contrast How much to scale the distance from the middle by, above one for more contrast
+ * @param max_colour The value which is full brightness, the image's max colour value
+ */
+channel_lut contrast_lut(double contrast, std::uint8_t max_colour = UINT8_MAX);
+
+/*!
+ * @brief Add to every value
+ * @param offset How much to add, negative to darken
+ * @param max_colour The value which is full brightness, the image's max colour value
+ */
+channel_lut brightness_lut(int offset, std::uint8_t max_colour = UINT8_MAX);
+
+/*!
+ * @brief One table doing what two do one after the other, so an image is only gone over once
+ * @param first The table applied first
+ * @param second The table applied to what first gives
+ */
+channel_lut combine(const channel_lut& first, const channel_lut& second);
+
+/*!
+ * @brief Look every channel of every pixel up in a table, in place, over bands of rows on their own threads.
+ * When built for a processor with AVX512 VBMI, such as with -march=native on one that has it, 64 bytes are
+ * looked up at once with byte permutes; otherwise it's a byte at a time.
+ * @param image The pixels to change
+ * @param red The table for the red channel
+ * @param green The table for the green channel
+ * @param blue The table for the blue channel
+ * @param threads How many threads to use, 0 means one per hardware thread
+ */
+void apply_lut(const mutable_image_view& image, const channel_lut& red, const channel_lut& green,
+			   const channel_lut& blue, unsigned threads = 1);
+
+/*!
+ * @brief Look every channel of every pixel up in the same table, in place
+ * @param image The pixels to change
+ * @param lut The table for all three channels
+ * @param threads How many threads to use, 0 means one per hardware thread
+ */
+void apply_lut(const mutable_image_view& image, const channel_lut& lut, unsigned threads = 1);
+
+#endif //SONGSIM_LUT_H
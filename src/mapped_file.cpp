@@ -0,0 +1,64 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mapped_file::mapped_file(const std::string &path) {
+	const auto fd = ::open(path.c_str(), O_RDONLY);
+	if( fd < 0 ) { throw std::runtime_error("Couldn't open " + path); }
+	struct stat st{};
+	if( ::fstat(fd, &st) != 0 || st.st_size <= 0 ) {
+		::close(fd);
+		throw std::runtime_error(path + " is empty");
+	}
+	_map(fd, static_cast<std::size_t>(st.st_size), false, path);
+}
+
+mapped_file::mapped_file(const std::string &path, const std::size_t size) {
+	const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if( fd < 0 ) { throw std::runtime_error("Couldn't open " + path); }
+	if( ::ftruncate(fd, static_cast<off_t>(size)) != 0 ) {
+		::close(fd);
+		throw std::runtime_error("Couldn't resize " + path);
+	}
+	_map(fd, size, true, path);
+}
+
+mapped_file::~mapped_file() {
+	_unmap();
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+		: _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+	if( this != &other ) {
+		_unmap();
+		_data = std::exchange(other._data, nullptr);
+		_size = std::exchange(other._size, 0);
+	}
+	return *this;
+}
+
+void mapped_file::sequential() const {
+	if( _data ) { ::madvise(_data, _size, MADV_SEQUENTIAL); }
+}
+
+void mapped_file::_map(const int fd, const std::size_t size, const bool writable, const std::string &path) {
+	void *data = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+						writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file open by itself
+	::close(fd);
+	if( data == MAP_FAILED ) { throw std::runtime_error("Couldn't map " + path); }
+	_data = static_cast<std::uint8_t *>(data);
+	_size = size;
+}
+
+void mapped_file::_unmap() {
+	if( _data ) { ::munmap(_data, _size); }
+	_data = nullptr;
+	_size = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SONGSIM_MAPPED_FILE_H
+#define SONGSIM_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*!
+ * @brief A whole file mapped into memory, unmapped when this goes.
+ * The file itself is closed as soon as it's mapped, the mapping keeps it open by itself.
+ */
+class mapped_file {
+public:
+	mapped_file() = default;
+
+	/*!
+	 * @brief Map a file to read
+	 * @param path The file, which can't be empty
+	 * @throw std::runtime_error if it can't be opened or mapped, or is empty
+	 */
+	explicit mapped_file(const std::string& path);
+
+	/*!
+	 * @brief Map a file to read and write, creating it or resizing it first. What's written goes to the file.
+	 * @param path The file
+	 * @param size The size to make it, which can't be 0
+	 * @throw std::runtime_error if it can't be opened, resized or mapped
+	 */
+	mapped_file(const std::string& path, std::size_t size);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+	mapped_file(mapped_file&& other) noexcept;
+	mapped_file& operator=(mapped_file&& other) noexcept;
+
+	/*!
+	 * @brief The bytes of the file, which are only valid while this is, and only writable if it was mapped to write
+	 */
+	std::uint8_t* 	data() const 	{ return _data; }
+	std::size_t 	size() const 	{ return _size; }
+
+	/*!
+	 * @brief Tell the kernel the file will be read from start to end, so it reads ahead further
+	 */
+	void sequential() const;
+
+private:
+	std::uint8_t* 	_data{nullptr};
+	std::size_t 	_size{0};
+
+	void _map(int fd, std::size_t size, bool writable, const std::string& path);
+	void _unmap();
+};
+
+#endif //SONGSIM_MAPPED_FILE_H
@@ -0,0 +1,96 @@
+#include "mapped_ppm.h"
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/*!
+ * @brief Reads the numbers of a PPM header, skipping the whitespace and comments between them
+ */
+class header_reader {
+public:
+	header_reader(const char* data, const std::size_t length, const std::string& path)
+			: _data(data), _length(length), _path(path)
+	{ /*! Intentionally Blank */ }
+
+	std::size_t pos() const { return _pos; }
+
+	void magic() {
+		if( _length < 2 || _data[0] != 'P' || _data[1] != '6' ) { fail("isn't a binary P6 file"); }
+		_pos = 2;
+	}
+
+	long number() {
+		while( _pos < _length && (std::isspace(static_cast<unsigned char>(_data[_pos])) || _data[_pos] == '#')) {
+			if( _data[_pos] == '#' ) {
+				while( _pos < _length && _data[_pos] != '\n' ) { _pos++; }
+			}
+			else {
+				_pos++;
+			}
+		}
+		const auto start = _pos;
+		auto n = 0L;
+		while( _pos < _length && std::isdigit(static_cast<unsigned char>(_data[_pos])) && n < 1L << 30 ) {
+			n = n * 10 + (_data[_pos++] - '0');
+		}
+		if( start == _pos ) { fail("has a bad header"); }
+		return n;
+	}
+
+	/*!
+	 * @brief Step over the single whitespace character between the header and the pixels
+	 */
+	void end() {
+		if( _pos >= _length || !std::isspace(static_cast<unsigned char>(_data[_pos]))) { fail("has a bad header"); }
+		_pos++;
+	}
+
+	[[noreturn]] void fail(const std::string& what) const {
+		throw std::runtime_error(_path + " " + what);
+	}
+
+private:
+	const char* 		_data;
+	std::size_t 		_length;
+	const std::string& 	_path;
+	std::size_t 		_pos{0};
+};
+
+}
+
+mapped_ppm::mapped_ppm(const std::string &path) : _file(path) {
+	static_assert(sizeof(rgb_pixel) == 3, "P6 pixels are viewed where they are in the file");
+	const auto *data = reinterpret_cast<const char *>(_file.data());
+	auto header = header_reader{data, _file.size(), path};
+	header.magic();
+	const auto width = header.number();
+	const auto height = header.number();
+	const auto max_colour = header.number();
+	header.end();
+	if( max_colour < 1 ) { header.fail("has a bad max colour"); }
+	if( max_colour > UINT8_MAX ) { header.fail("has 16 bit pixels, which can't be mapped"); }
+	if( _file.size() - header.pos() < static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 3 ) {
+		header.fail("is shorter than its header says");
+	}
+	_size = image_size{static_cast<int>(width), static_cast<int>(height)};
+	_max_colour = static_cast<uint8_t>(max_colour);
+	_pixels = reinterpret_cast<const rgb_pixel *>(data + header.pos());
+	// Statistics and comparisons go straight through from top to bottom
+	_file.sequential();
+}
+
+mapped_ppm::mapped_ppm(mapped_ppm &&other) noexcept
+		: _file(std::move(other._file)), _pixels(std::exchange(other._pixels, nullptr)),
+		  _size(std::exchange(other._size, image_size{})), _max_colour(other._max_colour) {}
+
+mapped_ppm &mapped_ppm::operator=(mapped_ppm &&other) noexcept {
+	if( this != &other ) {
+		_file = std::move(other._file);
+		_pixels = std::exchange(other._pixels, nullptr);
+		_size = std::exchange(other._size, image_size{});
+		_max_colour = other._max_colour;
+	}
+	return *this;
+}
@@ -0,0 +1,43 @@
+#ifndef SONGSIM_MAPPED_PPM_H
+#define SONGSIM_MAPPED_PPM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "mapped_file.h"
+#include "ppm_file.h"
+
+/*!
+ * @brief A binary P6 file mapped into memory, read only.
+ * Its pixels are viewed where they lie in the file, so nothing is decoded or copied and only
+ * the pages that are looked at are read from disk.
+ */
+class mapped_ppm {
+public:
+	/*!
+	 * @param path The P6 file to map, with a max colour value of at most 255
+	 * @throw std::runtime_error if it can't be opened or mapped, isn't a P6 file, or is shorter than its header says
+	 */
+	explicit mapped_ppm(const std::string& path);
+
+	mapped_ppm(const mapped_ppm&) = delete;
+	mapped_ppm& operator=(const mapped_ppm&) = delete;
+	mapped_ppm(mapped_ppm&& other) noexcept;
+	mapped_ppm& operator=(mapped_ppm&& other) noexcept;
+
+	const image_size& 	size() const 		{ return _size; 		}
+	uint8_t 			max_colour() const 	{ return _max_colour; 	}
+
+	/*!
+	 * @brief The pixels, which are only valid while this is
+	 */
+	image_view view() const { return {_pixels, _size, _size.width()}; }
+
+private:
+	mapped_file 		_file;
+	const rgb_pixel* 	_pixels{nullptr};
+	image_size 			_size;
+	uint8_t 			_max_colour{0};
+};
+
+#endif //SONGSIM_MAPPED_PPM_H
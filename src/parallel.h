@@ -0,0 +1,90 @@
+#ifndef SONGSIM_PARALLEL_H
+#define SONGSIM_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * @brief How many bands parallel_bands splits rows into
+ * @param rows The number of rows to split up
+ * @param threads The maximum number of threads to use, 0 means one per hardware thread
+ */
+inline int band_count(const int rows, unsigned threads) {
+	if( threads == 0 ) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+	return static_cast<int>(std::min<unsigned>(threads, static_cast<unsigned>(std::max(rows, 1))));
+}
+
+/*!
+ * @brief The first row of a band, and one past the last row of the band before
+ * @param rows The number of rows split up
+ * @param bands The number of bands from band_count
+ * @param band Which band, bands gives rows
+ */
+inline int band_start(const int rows, const int bands, const int band) {
+	return static_cast<int>(static_cast<long long>(rows) * band / bands);
+}
+
+/*!
+ * @brief Split the rows [0, rows) into contiguous bands and process each band on its own thread
+ * @param rows The number of rows to split up
+ * @param threads The maximum number of threads to use, 0 means one per hardware thread
+ * @param f Called as f(first_row, last_row, band_number) for each non empty band, last_row is one past the end
+ */
+template<typename F>
+void parallel_bands(const int rows, const unsigned threads, F f) {
+	const auto bands = band_count(rows, threads);
+	if( bands <= 1 ) {
+		f(0, rows, 0);
+		return;
+	}
+
+	auto workers = std::vector<std::thread>{};
+	for( int b = 1; b < bands; b++ ) {
+		workers.emplace_back([=, &f] { f(band_start(rows, bands, b), band_start(rows, bands, b + 1), b); });
+	}
+	// The calling thread does the first band rather than sitting idle
+	f(0, band_start(rows, bands, 1), 0);
+	for( auto &w: workers ) { w.join(); }
+}
+
+/*!
+ * @brief Run f(job) for every job in [0, jobs) on a pool of threads, each taking the next job as it becomes free.
+ * Use this rather than parallel_bands when the jobs take very different amounts of time.
+ * @param jobs The number of jobs
+ * @param threads The maximum number of threads to use, 0 means one per hardware thread
+ * @param f Called once for each job
+ * @throw Whatever the first job to throw threw, once every thread has stopped. No new jobs are started after it.
+ */
+template<typename F>
+void parallel_jobs(const std::size_t jobs, unsigned threads, F f) {
+	if( threads == 0 ) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+	threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(jobs, 1)));
+
+	auto next = std::atomic<std::size_t>{0};
+	auto error = std::exception_ptr{};
+	auto error_mutex = std::mutex{};
+	const auto worker = [&] {
+		for( auto job = next++; job < jobs; job = next++ ) {
+			try {
+				f(job);
+			}
+			catch( ... ) {
+				auto lock = std::lock_guard<std::mutex>{error_mutex};
+				if( !error ) { error = std::current_exception(); }
+				next = jobs;
+			}
+		}
+	};
+
+	auto workers = std::vector<std::thread>{};
+	for( unsigned t = 1; t < threads; t++ ) { workers.emplace_back(worker); }
+	worker();
+	for( auto &w: workers ) { w.join(); }
+	if( error ) { std::rethrow_exception(error); }
+}
+
+#endif //SONGSIM_PARALLEL_H
@@ -0,0 +1,231 @@
+#include "png.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <zlib.h>
+
+namespace {
+
+/*! Filtered bytes per strip, big enough that restarting the compressor for each costs little */
+constexpr auto strip_target = std::size_t{256 * 1024};
+
+/*! Bytes per pixel, which the Sub, Average and Paeth filters look back by */
+constexpr auto bpp = std::size_t{3};
+
+enum filter_type : std::uint8_t { NONE = 0, SUB = 1, UP = 2, AVERAGE = 3, PAETH = 4 };
+
+void put_u32(std::string &out, const std::uint32_t v) {
+	for( auto shift = 24; shift >= 0; shift -= 8 ) { out.push_back(static_cast<char>((v >> shift) & 0xff)); }
+}
+
+/*
+ * Each filter runs over the whole row in a plain loop without branches, which the compiler vectorises.
+ * The first pixel has nothing to its left, so it's done on its own with the left bytes taken as 0.
+ */
+
+std::uint8_t paeth(const int a, const int b, const int c) {
+	const auto pa = std::abs(b - c);
+	const auto pb = std::abs(a - c);
+	const auto pc = std::abs(a + b - 2 * c);
+	return static_cast<std::uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+void filter_row(const filter_type type, const std::uint8_t *row, const std::uint8_t *above, std::uint8_t *out,
+				const std::size_t n) {
+	const auto first = std::min(bpp, n);
+	switch( type ) {
+		case NONE:
+			std::copy(row, row + n, out);
+			break;
+		case SUB:
+			std::copy(row, row + first, out);
+			for( auto i = first; i < n; i++ ) { out[i] = static_cast<std::uint8_t>(row[i] - row[i - bpp]); }
+			break;
+		case UP:
+			for( std::size_t i = 0; i < n; i++ ) { out[i] = static_cast<std::uint8_t>(row[i] - above[i]); }
+			break;
+		case AVERAGE:
+			for( std::size_t i = 0; i < first; i++ ) { out[i] = static_cast<std::uint8_t>(row[i] - (above[i] >> 1)); }
+			for( auto i = first; i < n; i++ ) {
+				out[i] = static_cast<std::uint8_t>(row[i] - ((row[i - bpp] + above[i]) >> 1));
+			}
+			break;
+		case PAETH:
+			for( std::size_t i = 0; i < first; i++ ) { out[i] = static_cast<std::uint8_t>(row[i] - above[i]); }
+			for( auto i = first; i < n; i++ ) {
+				out[i] = static_cast<std::uint8_t>(row[i] - paeth(row[i - bpp], above[i], above[i - bpp]));
+			}
+			break;
+	}
+}
+
+/*!
+ * @brief How far a filtered row is from all zeros, taking each byte as signed, the usual guess at
+ * which filter will compress best
+ */
+std::uint64_t filter_cost(const std::uint8_t *out, const std::size_t n) {
+	auto cost = std::uint64_t{0};
+	for( std::size_t i = 0; i < n; i++ ) { cost += static_cast<std::uint64_t>(std::abs(static_cast<std::int8_t>(out[i]))); }
+	return cost;
+}
+
+/*!
+ * @brief A strip deflated as raw blocks, with what the Adler-32 of it would be
+ */
+struct deflated_strip {
+	std::string 	data;
+	std::uint32_t 	adler{0};
+};
+
+deflated_strip deflate_strip(const std::string &strip, const int level, const bool last) {
+	auto out = deflated_strip{};
+	out.adler = static_cast<std::uint32_t>(adler32(adler32(0, nullptr, 0), reinterpret_cast<const Bytef *>(strip.data()),
+												   static_cast<uInt>(strip.size())));
+
+	// No zlib header or trailer, and a window of its own so strips don't refer back into each other
+	auto stream = z_stream{};
+	if( deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK ) {
+		throw std::runtime_error("Couldn't start compressing a PNG strip");
+	}
+	stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(strip.data()));
+	stream.avail_in = static_cast<uInt>(strip.size());
+
+	// Syncing leaves the strip on a byte boundary without marking the last block, so the next strip can follow on
+	const auto flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+	auto result = Z_OK;
+	do {
+		const auto done = out.data.size();
+		out.data.resize(done + std::max<std::size_t>(strip.size() / 8, 4096));
+		stream.next_out = reinterpret_cast<Bytef *>(&out.data[done]);
+		stream.avail_out = static_cast<uInt>(out.data.size() - done);
+		result = deflate(&stream, flush);
+		out.data.resize(out.data.size() - stream.avail_out);
+	} while( result == Z_OK && (stream.avail_out == 0 || stream.avail_in != 0));
+	deflateEnd(&stream);
+	if( result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR ) {
+		throw std::runtime_error("Couldn't compress a PNG strip");
+	}
+	return out;
+}
+
+/*!
+ * @brief The two byte zlib header, for a 32K window and the compression level
+ */
+std::string zlib_header(const int level) {
+	constexpr auto cmf = 0x78;
+	const auto flevel = level == Z_DEFAULT_COMPRESSION ? 2 : level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+	auto flg = flevel << 6;
+	flg += (31 - (cmf * 256 + flg) % 31) % 31;
+	return {static_cast<char>(cmf), static_cast<char>(flg)};
+}
+
+}
+
+png_writer::png_writer(std::ostream &os, const image_size &size, const unsigned threads, const int level,
+					   const std::string &comment)
+		: _os(os), _size(size), _threads(threads), _level(level) {
+	if( size.width() <= 0 || size.height() <= 0 ) { throw std::runtime_error("A PNG can't be empty"); }
+	if( level != Z_DEFAULT_COMPRESSION && (level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)) {
+		throw std::runtime_error("Bad PNG compression level " + std::to_string(level));
+	}
+	if( _threads == 0 ) { _threads = std::max(1u, std::thread::hardware_concurrency()); }
+
+	const auto row_bytes = static_cast<std::size_t>(size.width()) * sizeof(rgb_pixel);
+	_previous.assign(row_bytes, 0);
+	_current.resize(row_bytes);
+	_trial.resize(row_bytes + 1);
+	_best.resize(row_bytes + 1);
+	_strip_bytes = std::max(strip_target, row_bytes + 1);
+	_strips.emplace_back();
+	_strips.back().reserve(_strip_bytes + row_bytes + 1);
+
+	_os.write("\x89PNG\r\n\x1a\n", 8);
+	auto header = std::string{};
+	put_u32(header, static_cast<std::uint32_t>(size.width()));
+	put_u32(header, static_cast<std::uint32_t>(size.height()));
+	header += std::string{8, 2, 0, 0, 0};	// 8 bit RGB, deflate, adaptive filters, no interlacing
+	_chunk("IHDR", header);
+	if( !comment.empty()) { _chunk("tEXt", std::string{"Comment"} + '\0' + comment); }
+	hash_size(_hash, size);
+}
+
+void png_writer::write_row(const rgb_pixel *row, std::size_t count) {
+	if( _rows >= _size.height()) { throw std::runtime_error("Every row of the PNG has been written"); }
+	count = std::min(count, static_cast<std::size_t>(_size.width()));
+	hash_row(_hash, row, count, static_cast<std::size_t>(_size.width()));
+
+	static_assert(sizeof(rgb_pixel) == 3, "Rows are filtered straight from the pixels");
+	const auto *bytes = reinterpret_cast<const std::uint8_t *>(row);
+	std::copy(bytes, bytes + count * sizeof(rgb_pixel), _current.begin());
+	std::fill(_current.begin() + static_cast<std::ptrdiff_t>(count * sizeof(rgb_pixel)), _current.end(), 0xff);
+
+	const auto n = _current.size();
+	auto best_cost = std::numeric_limits<std::uint64_t>::max();
+	for( const auto type: {NONE, SUB, UP, AVERAGE, PAETH} ) {
+		_trial[0] = type;
+		filter_row(type, _current.data(), _previous.data(), _trial.data() + 1, n);
+		const auto cost = filter_cost(_trial.data() + 1, n);
+		if( cost < best_cost ) {
+			best_cost = cost;
+			std::swap(_trial, _best);
+		}
+	}
+	_strips.back().append(reinterpret_cast<const char *>(_best.data()), _best.size());
+	std::swap(_previous, _current);
+
+	if( ++_rows == _size.height()) {
+		_deflate_strips(true);
+		return;
+	}
+	if( _strips.back().size() >= _strip_bytes ) {
+		if( _strips.size() == _threads ) { _deflate_strips(false); }
+		_strips.emplace_back();
+		_strips.back().reserve(_strip_bytes + n + 1);
+	}
+}
+
+void png_writer::_deflate_strips(const bool last) {
+	auto deflated = std::vector<deflated_strip>(_strips.size());
+	parallel_jobs(_strips.size(), _threads, [&](const std::size_t strip) {
+		deflated[strip] = deflate_strip(_strips[strip], _level, last && strip + 1 == _strips.size());
+	});
+
+	for( std::size_t strip = 0; strip < deflated.size(); strip++ ) {
+		auto &data = deflated[strip].data;
+		_adler = static_cast<std::uint32_t>(adler32_combine(_adler, deflated[strip].adler,
+															static_cast<z_off_t>(_strips[strip].size())));
+		if( !_started ) {
+			data.insert(0, zlib_header(_level));
+			_started = true;
+		}
+		if( last && strip + 1 == deflated.size()) { put_u32(data, _adler); }
+		_chunk("IDAT", data);
+	}
+	_strips.clear();
+	if( last ) { _chunk("IEND", {}); }
+}
+
+void png_writer::_chunk(const char *type, const std::string &data) {
+	auto head = std::string{};
+	put_u32(head, static_cast<std::uint32_t>(data.size()));
+	head.append(type, 4);
+	auto crc = crc32(crc32(0, nullptr, 0), reinterpret_cast<const Bytef *>(type), 4);
+	crc = crc32(crc, reinterpret_cast<const Bytef *>(data.data()), static_cast<uInt>(data.size()));
+	auto tail = std::string{};
+	put_u32(tail, static_cast<std::uint32_t>(crc));
+
+	_os.write(head.data(), static_cast<std::streamsize>(head.size()));
+	_os.write(data.data(), static_cast<std::streamsize>(data.size()));
+	_os.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+}
+
+std::uint64_t write_png(std::ostream &os, const image_view &v, const unsigned threads, const int level) {
+	auto writer = png_writer{os, v.size(), threads, level};
+	for( auto row{0}; row < v.size().height(); row++ ) {
+		writer.write_row(v[row]);
+	}
+	return writer.pixel_hash();
+}
@@ -0,0 +1,82 @@
+#ifndef SONGSIM_PNG_H
+#define SONGSIM_PNG_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ppm_file.h"
+
+/*!
+ * @brief Writes a PNG file a row at a time, like ppm_writer.
+ * Each row is filtered as it's added with whichever of the five PNG filters leaves the smallest
+ * differences. The filtered rows are gathered into strips, which are deflated on their own threads,
+ * each starting afresh, then joined into the one zlib stream PNG needs, with their Adler-32 checksums combined.
+ * The file is finished when the last row is written.
+ */
+class png_writer
+{
+public:
+	/*!
+	 * @brief Write the header
+	 * @param os The stream destination, which must outlive the writer
+	 * @param size The dimensions of the image, which can't be empty
+	 * @param threads How many strips to deflate at once, 0 means one per hardware thread
+	 * @param level The zlib compression level, from 0 for none to 9 for the smallest
+	 * @param comment Put in a tEXt chunk as a Comment, if it isn't empty
+	 * @throw std::runtime_error if the image is empty or the level isn't one zlib has
+	 */
+	png_writer(std::ostream& os, const image_size& size, unsigned threads = 1, int level = 6,
+			   const std::string& comment = {});
+
+	/*!
+	 * @brief Write the next row.
+	 * Short rows are padded with white pixels, as ppm_writer does.
+	 * @param row The pixels
+	 * @param count How many pixels there are
+	 * @throw std::runtime_error if every row's already been written
+	 */
+	void write_row(const rgb_pixel* row, std::size_t count);
+
+	/*!
+	 * @brief Write the next row
+	 * @param row The pixels
+	 */
+	void write_row(const ppm_image::const_line_type& row) { write_row(row.data(), row.size()); }
+
+	/*!
+	 * @brief The same hash of the rows written so far as ppm_writer::pixel_hash
+	 */
+	std::uint64_t pixel_hash() const { return _hash.digest(); }
+
+private:
+	std::ostream& 					_os;
+	image_size 						_size;
+	unsigned 						_threads;
+	int 							_level;
+	int 							_rows{0};			/*! Rows written so far 							*/
+	std::size_t 					_strip_bytes;		/*! Filtered bytes to gather before a strip is full 	*/
+	std::vector<std::uint8_t> 		_previous;			/*! The last row, which the next is filtered against 	*/
+	std::vector<std::uint8_t> 		_current;
+	std::vector<std::uint8_t> 		_trial;				/*! A filter being tried, with its type first 		*/
+	std::vector<std::uint8_t> 		_best;				/*! The best filtered row so far 					*/
+	std::vector<std::string> 		_strips;			/*! Filtered rows waiting to be deflated 			*/
+	std::uint32_t 					_adler{1};			/*! Of everything deflated so far 					*/
+	bool 							_started{false};	/*! Whether the zlib header's been written 			*/
+	xxh64 							_hash;
+
+	void _deflate_strips(bool last);
+	void _chunk(const char* type, const std::string& data);
+};
+
+/*!
+ * @brief Write the pixels of a view as a PNG file
+ * @param os The stream destination
+ * @param v The pixels to write, which can't be empty
+ * @param threads How many strips to deflate at once, 0 means one per hardware thread
+ * @param level The zlib compression level, from 0 for none to 9 for the smallest
+ * @return The hash of the pixels written, the same as image_hash(v)
+ */
+std::uint64_t write_png(std::ostream& os, const image_view& v, unsigned threads = 1, int level = 6);
+
+#endif //SONGSIM_PNG_H
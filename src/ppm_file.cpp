@@ -3,6 +3,7 @@
 //
 
 #include "ppm_file.h"
+#include <algorithm>
 #include <cassert>
 
 const rgb_pixel rgb_pixel::_examples[] = {
@@ -30,9 +31,16 @@ bool image_size::operator!=(const image_size &rhs) const {
 	return rhs.width() != width() || rhs.height() != height();
 }
 
-void ppm_image::_width_check(const std::vector<rgb_pixel> &last_line) {
-	if( last_line.size() > _size.width()) {
-		_size.width() = { static_cast<int>(last_line.size()) };
+ppm_image::ppm_image(const image_size &size, const rgb_pixel &fill, std::pmr::memory_resource *resource)
+		: _size(size), _stride(size.width()),
+		  _pixels(static_cast<std::size_t>(size.width()) * static_cast<std::size_t>(size.height()), fill, resource),
+		  _lengths(static_cast<std::size_t>(size.height()), size.width(), resource) {
+	_colour_check(fill);
+}
+
+void ppm_image::_width_check(const int length) {
+	if( length > _size.width()) {
+		_size.width() = length;
 		_fill();
 	}
 }
@@ -45,21 +53,30 @@ void ppm_image::_colour_check(const rgb_pixel &new_val) {
 
 void ppm_image::operator<<(const std::vector<rgb_pixel> &line) {
 	new_line();
+	// Make room for the whole line at once rather than growing as it's added
+	if( static_cast<int>(line.size()) > _stride ) { _restride(static_cast<int>(line.size())); }
 	for( rgb_pixel n: line ) {
 		*this << n;
 	}
 }
 
 void ppm_image::new_line() {
-	_data.emplace_back(std::vector<rgb_pixel>());
+	// A row that grew past the others left room for more, take it back now the row is finished
+	if( _stride > _size.width()) { _restride(_size.width()); }
+	_pixels.resize(_pixels.size() + static_cast<std::size_t>(_stride), rgb_pixel::get_colour(rgb_pixel::colours::WHITE));
+	_lengths.push_back(0);
 	_size.height()++;
 }
 
 void ppm_image::operator<<(const rgb_pixel &n) {
-	if( _data.empty()) { new_line(); }
-	std::vector<rgb_pixel> &last_line{ _data[_data.size() - 1]};
-	last_line.push_back(n);
-	_width_check(last_line);
+	if( _lengths.empty()) { new_line(); }
+	const auto row = _lengths.size() - 1;
+	auto &length = _lengths[row];
+	// Double the room so adding a pixel at a time doesn't move everything each time
+	if( length == _stride ) { _restride(std::max(1, _stride * 2)); }
+	_pixels[row * static_cast<std::size_t>(_stride) + static_cast<std::size_t>(length)] = n;
+	length++;
+	_width_check(length);
 	_colour_check(n);
 
 }
@@ -69,19 +86,95 @@ void ppm_image::append_last_line(const rgb_pixel &n) {
 }
 
 std::ostream &operator<<(std::ostream &os, const ppm_image &ppm) {
-	os << "P3" << std::endl << ppm._size << std::endl << std::to_string(ppm._max_colour_value) << std::endl;
-	/*! Iterate over the 2d datastructure and output it to the stream */
-	for( std::vector<rgb_pixel> line: ppm._data ) {
-		for( rgb_pixel n: line ) {
-			os << n << " ";
+	ppm.write(os, ppm_image::format::P3);
+	return os;
+}
+
+std::uint64_t ppm_image::write(std::ostream &os, const format f, const std::string &comment) const {
+	auto writer = ppm_writer{os, _size, _max_colour_value, f, comment};
+	for( auto row{0}; row < _size.height(); row++ ) {
+		writer.write_row((*this)[row]);
+	}
+	return writer.pixel_hash();
+}
+
+std::uint64_t write_view(std::ostream &os, const image_view &v, const ppm_image::format f, const uint8_t max_colour) {
+	auto writer = ppm_writer{os, v.size(), max_colour, f};
+	for( auto row{0}; row < v.size().height(); row++ ) {
+		writer.write_row(v[row]);
+	}
+	return writer.pixel_hash();
+}
+
+ppm_writer::ppm_writer(std::ostream &os, const image_size &size, const uint8_t max_colour, const ppm_image::format f,
+					   const std::string &comment)
+		: _os(os), _size(size), _format(f) {
+	_os << (f == ppm_image::format::P3 ? "P3" : "P6") << "\n";
+	for( std::size_t start = 0; start < comment.size(); ) {
+		const auto end = std::min(comment.find('\n', start), comment.size());
+		_os << "# " << comment.substr(start, end - start) << "\n";
+		start = end + 1;
+	}
+	_os << _size << "\n" << std::to_string(max_colour) << "\n";
+	hash_size(_hash, size);
+}
+
+void ppm_writer::write_row(const rgb_pixel *row, const std::size_t count) {
+	// Hashed while the row is in the cache
+	const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+	hash_row(_hash, row, count, static_cast<std::size_t>(_size.width()));
+
+	if( _format == ppm_image::format::P3 ) {
+		for( auto n = row; n != row + count; ++n ) {
+			_os << *n << " ";
 		}
-		os << "\n";
+		_os << "\n";
+		return;
 	}
-	return os;
+
+	static_assert(sizeof(rgb_pixel) == 3, "P6 rows are written straight from the pixels");
+	_os.write(reinterpret_cast<const char *>(row), static_cast<std::streamsize>(count * sizeof(rgb_pixel)));
+	for( auto col{count}; col < static_cast<std::size_t>(_size.width()); col++ ) {
+		_os.write(reinterpret_cast<const char *>(&white), sizeof(white));
+	}
+}
+
+std::uint64_t image_hash(const image_view &v) {
+	auto h = xxh64{};
+	hash_size(h, v.size());
+	const auto bytes = static_cast<std::size_t>(std::max(v.size().width(), 0)) * sizeof(rgb_pixel);
+	if( v.contiguous()) {
+		h.update(v.data(), bytes * static_cast<std::size_t>(std::max(v.size().height(), 0)));
+	}
+	else {
+		for( auto row{0}; row < v.size().height(); row++ ) { h.update(v[row].data(), bytes); }
+	}
+	return h.digest();
+}
+
+void hash_size(xxh64 &h, const image_size &size) {
+	unsigned char bytes[8];
+	for( auto i = 0; i < 4; i++ ) {
+		bytes[i] = static_cast<unsigned char>(static_cast<std::uint32_t>(size.width()) >> (8 * i));
+		bytes[4 + i] = static_cast<unsigned char>(static_cast<std::uint32_t>(size.height()) >> (8 * i));
+	}
+	h.update(bytes, sizeof(bytes));
 }
 
-std::vector<rgb_pixel> &ppm_image::operator[](const int n) {
-	return _data[n];
+void hash_row(xxh64 &h, const rgb_pixel *row, const std::size_t count, const std::size_t width) {
+	const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+	h.update(row, count * sizeof(rgb_pixel));
+	for( auto col{count}; col < width; col++ ) { h.update(&white, sizeof(white)); }
+}
+
+ppm_image::line_type ppm_image::operator[](const int n) {
+	return {_pixels.data() + static_cast<std::size_t>(n) * static_cast<std::size_t>(_stride),
+			static_cast<std::size_t>(_lengths[n])};
+}
+
+ppm_image::const_line_type ppm_image::operator[](const int n) const {
+	return {_pixels.data() + static_cast<std::size_t>(n) * static_cast<std::size_t>(_stride),
+			static_cast<std::size_t>(_lengths[n])};
 }
 
 std::ostream &operator<<(std::ostream &os, const rgb_pixel &p) {
@@ -99,13 +192,17 @@ std::ostream &operator<<(std::ostream &os, const image_size &s) {
 }
 
 void ppm_image::_fill() {
-	for_each(_data.begin(), _data.end(), [*this](std::vector<rgb_pixel> &row) {
-		if( row.size() < _size.width()) {
-			for( auto col{static_cast<int>(row.size())}; col < _size.width(); col++ ) {
-				row.emplace_back(rgb_pixel::get_colour(rgb_pixel::colours::WHITE));
-			}
-		}
-	});
+	// The rest of each row is already white, it only needs counting as part of the row
+	std::fill(_lengths.begin(), _lengths.end(), _size.width());
 }
 
-
+void ppm_image::_restride(const int stride) {
+	auto pixels = std::pmr::vector<rgb_pixel>(static_cast<std::size_t>(stride) * _lengths.size(),
+											  rgb_pixel::get_colour(rgb_pixel::colours::WHITE), resource());
+	const auto kept = static_cast<std::size_t>(std::min(stride, _stride));
+	for( std::size_t row = 0; row < _lengths.size(); row++ ) {
+		std::copy_n(_pixels.data() + row * _stride, kept, pixels.data() + row * stride);
+	}
+	_pixels.swap(pixels);
+	_stride = stride;
+}
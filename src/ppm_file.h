@@ -5,9 +5,14 @@
 #ifndef SONGSIM_PPM_FILE_H
 #define SONGSIM_PPM_FILE_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <iostream>
+#include <memory_resource>
+#include "hash.h"
 
 
 /*!
@@ -164,18 +169,166 @@ private:
 };
 
 /*!
- * @brief A PPM file
+ * @brief A rectangle of an image, in pixels from the top left
+ */
+struct image_rect {
+	int x{0};		/*! The leftmost column 	*/
+	int y{0};		/*! The top row 			*/
+	int width{0};
+	int height{0};
+};
+
+/*!
+ * @brief A line of pixels which belongs to something else, like a span
+ * @tparam Pixel rgb_pixel, or const rgb_pixel for a read only line
+ */
+template<typename Pixel>
+class basic_line {
+public:
+	basic_line() = default;
+
+	basic_line(Pixel* data, const std::size_t size)
+			: _data(data), _size(size)
+	{ /*! Intentionally Blank */ }
+
+	/*!
+	 * @brief A mutable line can always be read from
+	 */
+	operator basic_line<const Pixel>() const { return {_data, _size}; }
+
+	Pixel* 		data() const 							{ return _data; 			}
+	std::size_t size() const 							{ return _size; 			}
+	bool 		empty() const 							{ return _size == 0; 		}
+	Pixel* 		begin() const 							{ return _data; 			}
+	Pixel* 		end() const 							{ return _data + _size; 	}
+	Pixel& 		front() const 							{ return _data[0]; 			}
+	Pixel& 		back() const 							{ return _data[_size - 1]; 	}
+	Pixel& 		operator[](const std::size_t n) const 	{ return _data[n]; 			}
+
+	/*!
+	 * @brief Whether the lines hold the same pixels
+	 */
+	template<typename Other>
+	bool operator==(const basic_line<Other>& rhs) const {
+		return std::equal(begin(), end(), rhs.begin(), rhs.end());
+	}
+
+private:
+	Pixel* 		_data{nullptr};
+	std::size_t _size{0};
+};
+
+/*!
+ * @brief A rectangle of pixels which belongs to something else, such as a ppm_image or a mapped file.
+ * Each row is width pixels long and starts stride pixels after the one above, so cropping is only arithmetic.
+ * @tparam Pixel rgb_pixel, or const rgb_pixel for a read only view
+ */
+template<typename Pixel>
+class basic_image_view {
+public:
+	basic_image_view() = default;
+
+	/*!
+	 * @param data The top left pixel
+	 * @param size The width and height
+	 * @param stride The distance from the start of one row to the start of the next, in pixels
+	 */
+	basic_image_view(Pixel* data, const image_size& size, const std::ptrdiff_t stride)
+			: _data(data), _size(size), _stride(stride)
+	{ /*! Intentionally Blank */ }
+
+	/*!
+	 * @brief A mutable view can always be read from
+	 */
+	operator basic_image_view<const Pixel>() const { return {_data, _size, _stride}; }
+
+	Pixel* 				data() const 	{ return _data; 	}
+	const image_size& 	size() const 	{ return _size; 	}
+	std::ptrdiff_t 		stride() const 	{ return _stride; 	}
+	bool 				empty() const 	{ return _size.width() <= 0 || _size.height() <= 0; }
+
+	/*!
+	 * @brief Whether the rows follow on from each other with no gaps, so the pixels can be treated as one run
+	 */
+	bool contiguous() const { return _stride == _size.width(); }
+
+	/*!
+	 * @brief Access a row
+	 * @param y The row, which must be in the view
+	 * @return The row
+	 */
+	basic_line<Pixel> operator[](const int y) const {
+		return {_data + y * _stride, static_cast<std::size_t>(_size.width())};
+	}
+
+	/*!
+	 * @brief A view of part of this one, without copying anything
+	 * @param r The part to view, relative to this view. It's clipped to the view, so may end up empty.
+	 * @return The view of the part
+	 */
+	basic_image_view crop(const image_rect& r) const {
+		const auto left = std::clamp(r.x, 0, _size.width());
+		const auto top = std::clamp(r.y, 0, _size.height());
+		const auto right = std::clamp(r.x + std::max(r.width, 0), left, _size.width());
+		const auto bottom = std::clamp(r.y + std::max(r.height, 0), top, _size.height());
+		return {_data + top * _stride + left, image_size{right - left, bottom - top}, _stride};
+	}
+
+private:
+	Pixel* 			_data{nullptr};
+	image_size 		_size;
+	std::ptrdiff_t 	_stride{0};
+};
+
+using image_view = basic_image_view<const rgb_pixel>;		/*! A read only view 	*/
+using mutable_image_view = basic_image_view<rgb_pixel>;		/*! A writable view 	*/
+
+/*!
+ * @brief A PPM file.
+ * The pixels are held in one block, each row a fixed stride after the one before,
+ * so they can be handed out as image_views. Rows added a pixel at a time may be shorter than the image
+ * until a wider row is added; the rest of a short row is held as white.
  */
 class ppm_image
 {
 public:
+	/*!
+	 * @brief The flavours of PPM file which can be written
+	 */
+	enum class format {
+		P3,	/*! Plain text, each value written as a decimal number 	*/
+		P6	/*! Binary, each value written as a single byte 		*/
+	};
+
+	/*!
+	 * @brief A line of pixels in the image
+	 */
+	using line_type = basic_line<rgb_pixel>;
+	/*!
+	 * @brief A read only line of pixels in the image
+	 */
+	using const_line_type = basic_line<const rgb_pixel>;
+
 	/// Ctors
 	ppm_image() = default;
 
-	ppm_image(const uint8_t max_colour)
-			: _max_colour_value(max_colour)
+	/*!
+	 * @param max_colour The max colour value to start with
+	 * @param resource Where the pixels are allocated from, to count or pool the allocations
+	 */
+	ppm_image(const uint8_t max_colour, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: _max_colour_value(max_colour), _pixels(resource), _lengths(resource)
 	{ /*! Intentionally Blank */ }
 
+	/*!
+	 * @brief Create an image of a fixed size with every pixel the same colour
+	 * @param size The dimensions of the image
+	 * @param fill The colour of every pixel
+	 * @param resource Where the pixels are allocated from, to count or pool the allocations
+	 */
+	ppm_image(const image_size& size, const rgb_pixel& fill,
+			  std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
 	//----------------
 	/*!
 	 * @brief Accessor
@@ -199,6 +352,24 @@ public:
 	 */
 	const image_size&		size() const		{ return _size; 			}
 
+	/*!
+	 * @brief Accessor
+	 * @return Where the pixels are allocated from
+	 */
+	std::pmr::memory_resource* resource() const	{ return _pixels.get_allocator().resource(); }
+
+	/*!
+	 * @brief View the whole image, short rows included as padded with white.
+	 * The view is invalidated by anything which adds pixels or lines.
+	 * @return The view
+	 */
+	mutable_image_view		view()				{ return {_pixels.data(), _size, _stride}; }
+	/*!
+	 * @brief Const view of the whole image
+	 * @return The view
+	 */
+	image_view 				view() const		{ return {_pixels.data(), _size, _stride}; }
+
 	/*!
 	 * @brief Add a value to the last line
 	 * @param n The value to add
@@ -230,24 +401,51 @@ public:
 	 */
 	friend std::ostream& operator<<(std::ostream& os, const ppm_image& ppm);
 
+	/*!
+	 * @brief Write out the image data, including header.
+	 * Short rows are padded with white pixels in P6 so the rows after them aren't shifted.
+	 * @param os The stream destination
+	 * @param f The flavour of file to write
+	 * @param comment Put in the header as a comment, if it isn't empty
+	 * @return The hash of the pixels written, the same as image_hash(view())
+	 */
+	std::uint64_t write(std::ostream& os, format f, const std::string& comment = {}) const;
+
 	/*!
 	 * @brief Allows access to the image line by line
 	 * @param n The line to get
-	 * @return The line
+	 * @return The line, which is only as long as the pixels added to it
 	 */
-	std::vector<rgb_pixel>&operator[](const int n);
+	line_type operator[](const int n);
+
+	/*!
+	 * @brief Allows const access to the image line by line
+	 * @param n The line to get
+	 * @return The line, which is only as long as the pixels added to it
+	 */
+	const_line_type operator[](const int n) const;
 
 private:
 	uint8_t 							_max_colour_value{0};
 	image_size							_size;
-	std::vector<std::vector<rgb_pixel>> _data;
+	/*! The distance between the starts of the rows, at least the width so rows can grow before being moved */
+	int 								_stride{0};
+	std::pmr::vector<rgb_pixel> 		_pixels;
+	/*! How many pixels have been added to each line */
+	std::pmr::vector<int> 				_lengths;
 
 	/*!
 	 * @brief Check that the width of the line doesn't overrun the current width, if it does then
 	 * update the curreent width
-	 * @param last_line The line to check
+	 * @param length The length of the line to check
 	 */
-	void _width_check(const std::vector<rgb_pixel> &last_line);
+	void _width_check(int length);
+
+	/**
+	 * @brief      Move the rows further apart, or closer together, padding them with white
+	 * @param[in]  stride  The new stride, at least the width
+	 */
+	void _restride(int stride);
 
 	/*!
 	 * @brief Check that the new colour value entered is in the range, if not - increase the range
@@ -262,7 +460,85 @@ private:
 
 };
 
+/*!
+ * @brief Writes a PPM file a row at a time, so an image too big to hold whole can be written as it's drawn
+ */
+class ppm_writer
+{
+public:
+	/*!
+	 * @brief Write the header
+	 * @param os The stream destination, which must outlive the writer
+	 * @param size The dimensions of the image
+	 * @param max_colour The max colour value of any pixel
+	 * @param f The flavour of file to write
+	 * @param comment Put in the header as a comment, a line at a time, if it isn't empty
+	 */
+	ppm_writer(std::ostream& os, const image_size& size, uint8_t max_colour, ppm_image::format f,
+			   const std::string& comment = {});
+
+	/*!
+	 * @brief Write the next row.
+	 * Short rows are padded with white pixels in P6 so the rows after them aren't shifted.
+	 * @param row The pixels
+	 * @param count How many pixels there are
+	 */
+	void write_row(const rgb_pixel* row, std::size_t count);
+
+	/*!
+	 * @brief Write the next row
+	 * @param row The pixels
+	 */
+	void write_row(const ppm_image::const_line_type& row) { write_row(row.data(), row.size()); }
+
+	/*!
+	 * @brief The hash of the size and the rows written so far, worked out as they're written.
+	 * Once every row is written it's the same as image_hash of the image, whichever format it was written in.
+	 */
+	std::uint64_t pixel_hash() const { return _hash.digest(); }
+
+private:
+	std::ostream& 		_os;
+	image_size 			_size;
+	ppm_image::format 	_format;
+	xxh64 				_hash;
+};
+
+
 
 
+/*!
+ * @brief Write the pixels of a view as a PPM file, such as a crop of a bigger image
+ * @param os The stream destination
+ * @param v The pixels to write
+ * @param f The flavour of file to write
+ * @param max_colour The max colour value to give in the header
+ * @return The hash of the pixels written, the same as image_hash(v)
+ */
+std::uint64_t write_view(std::ostream& os, const image_view& v, ppm_image::format f, uint8_t max_colour = UINT8_MAX);
+
+/*!
+ * @brief A fingerprint of the size and pixels of an image, the XXH64 of its width and height as
+ * little endian 32 bit numbers followed by the bytes of each row
+ * @param v The pixels
+ * @return The hash, the same as ppm_writer::pixel_hash once the pixels have been written
+ */
+std::uint64_t image_hash(const image_view& v);
+
+/*!
+ * @brief Start an image_hash with the size, for writers which hash the rows as they go
+ * @param h The hash to add to
+ * @param size The dimensions of the image
+ */
+void hash_size(xxh64& h, const image_size& size);
+
+/*!
+ * @brief Add a row to an image_hash as the writers write it, with a short row's missing pixels white
+ * @param h The hash to add to
+ * @param row The pixels
+ * @param count How many pixels there are
+ * @param width How wide the image is
+ */
+void hash_row(xxh64& h, const rgb_pixel* row, std::size_t count, std::size_t width);
 
 #endif //SONGSIM_PPM_FILE_H
@@ -0,0 +1,224 @@
+#include "qoi.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint8_t op_index = 0x00;
+constexpr std::uint8_t op_diff = 0x40;
+constexpr std::uint8_t op_luma = 0x80;
+constexpr std::uint8_t op_run = 0xc0;
+constexpr std::uint8_t op_rgb = 0xfe;
+constexpr std::uint8_t op_rgba = 0xff;
+constexpr std::uint8_t op_mask = 0xc0;
+
+/*! The longest run one byte can hold, 63 and 64 would look like op_rgb and op_rgba */
+constexpr auto max_run = 62;
+
+constexpr auto header_bytes = std::size_t{14};
+constexpr std::uint8_t end_marker[] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+/*! The most pixels the format allows, which stops a bad header asking for all the memory there is */
+constexpr auto max_pixels = std::uint64_t{400000000};
+
+/*
+ * Pixels are packed into a word as R, G, B, A from the lowest byte, so comparing them is one comparison
+ */
+
+std::uint32_t pack(const std::uint8_t r, const std::uint8_t g, const std::uint8_t b, const std::uint8_t a) {
+	return r | static_cast<std::uint32_t>(g) << 8 | static_cast<std::uint32_t>(b) << 16 | static_cast<std::uint32_t>(a) << 24;
+}
+
+std::uint32_t pack(const rgb_pixel &p) {
+	return pack(p.red(), p.green(), p.blue(), 0xff);
+}
+
+std::uint8_t channel(const std::uint32_t packed, const int c) {
+	return static_cast<std::uint8_t>(packed >> (8 * c));
+}
+
+std::size_t seen_slot(const std::uint32_t packed) {
+	return (channel(packed, 0) * 3u + channel(packed, 1) * 5u + channel(packed, 2) * 7u + channel(packed, 3) * 11u) % 64;
+}
+
+void put_u32(std::uint8_t *out, const std::uint32_t v) {
+	for( auto i = 0; i < 4; i++ ) { out[i] = static_cast<std::uint8_t>(v >> (24 - 8 * i)); }
+}
+
+std::uint32_t get_u32(const std::uint8_t *in) {
+	return static_cast<std::uint32_t>(in[0]) << 24 | static_cast<std::uint32_t>(in[1]) << 16 |
+		   static_cast<std::uint32_t>(in[2]) << 8 | in[3];
+}
+
+}
+
+qoi_writer::qoi_writer(std::ostream &os, const image_size &size)
+		: _os(os), _size(size), _previous(pack(0, 0, 0, 0xff)) {
+	if( size.width() <= 0 || size.height() <= 0 ) { throw std::runtime_error("A QOI image can't be empty"); }
+
+	// At worst every pixel is op_rgb, plus the runs left over from the row before and at the end, and the end marker
+	_buffer.resize(static_cast<std::size_t>(size.width()) * 4 + 2 + sizeof(end_marker));
+
+	std::uint8_t header[header_bytes] = {'q', 'o', 'i', 'f'};
+	put_u32(header + 4, static_cast<std::uint32_t>(size.width()));
+	put_u32(header + 8, static_cast<std::uint32_t>(size.height()));
+	header[12] = 3;		// RGB
+	header[13] = 0;		// sRGB with linear alpha
+	_os.write(reinterpret_cast<const char *>(header), sizeof(header));
+	hash_size(_hash, size);
+}
+
+std::uint8_t *qoi_writer::_encode(const rgb_pixel *row, const std::size_t count, std::uint8_t *out) {
+	for( std::size_t x = 0; x < count; ) {
+		const auto pixel = pack(row[x]);
+		if( pixel == _previous ) {
+			// Most of a SongSim image is runs of white, so find where this one stops in one go
+			auto end = x + 1;
+			while( end < count && pack(row[end]) == pixel ) { end++; }
+			_run += static_cast<int>(end - x);
+			for( ; _run >= max_run; _run -= max_run ) { *out++ = op_run | (max_run - 1); }
+			x = end;
+			continue;
+		}
+		if( _run > 0 ) {
+			*out++ = static_cast<std::uint8_t>(op_run | (_run - 1));
+			_run = 0;
+		}
+
+		const auto slot = seen_slot(pixel);
+		if( _seen[slot] == pixel ) {
+			*out++ = static_cast<std::uint8_t>(op_index | slot);
+		}
+		else {
+			_seen[slot] = pixel;
+			const auto dr = static_cast<std::int8_t>(channel(pixel, 0) - channel(_previous, 0));
+			const auto dg = static_cast<std::int8_t>(channel(pixel, 1) - channel(_previous, 1));
+			const auto db = static_cast<std::int8_t>(channel(pixel, 2) - channel(_previous, 2));
+			const auto dr_dg = dr - dg;
+			const auto db_dg = db - dg;
+			if( dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1 ) {
+				*out++ = static_cast<std::uint8_t>(op_diff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+			}
+			else if( dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7 ) {
+				*out++ = static_cast<std::uint8_t>(op_luma | (dg + 32));
+				*out++ = static_cast<std::uint8_t>((dr_dg + 8) << 4 | (db_dg + 8));
+			}
+			else {
+				*out++ = op_rgb;
+				*out++ = channel(pixel, 0);
+				*out++ = channel(pixel, 1);
+				*out++ = channel(pixel, 2);
+			}
+		}
+		_previous = pixel;
+		x++;
+	}
+	return out;
+}
+
+void qoi_writer::write_row(const rgb_pixel *row, std::size_t count) {
+	if( _rows >= _size.height()) { throw std::runtime_error("Every row of the QOI image has been written"); }
+	const auto width = static_cast<std::size_t>(_size.width());
+	count = std::min(count, width);
+	hash_row(_hash, row, count, width);
+
+	auto *out = _encode(row, count, _buffer.data());
+	if( count < width ) {
+		const auto white = rgb_pixel::get_colour(rgb_pixel::colours::WHITE);
+		for( auto col{count}; col < width; col++ ) { out = _encode(&white, 1, out); }
+	}
+	if( ++_rows == _size.height()) {
+		if( _run > 0 ) { *out++ = static_cast<std::uint8_t>(op_run | (_run - 1)); }
+		out = std::copy(std::begin(end_marker), std::end(end_marker), out);
+	}
+	_os.write(reinterpret_cast<const char *>(_buffer.data()), out - _buffer.data());
+}
+
+std::uint64_t write_qoi(std::ostream &os, const image_view &v) {
+	auto writer = qoi_writer{os, v.size()};
+	for( auto row{0}; row < v.size().height(); row++ ) {
+		writer.write_row(v[row]);
+	}
+	return writer.pixel_hash();
+}
+
+ppm_image read_qoi(std::istream &is) {
+	std::uint8_t header[header_bytes];
+	if( !is.read(reinterpret_cast<char *>(header), sizeof(header)) || std::memcmp(header, "qoif", 4) != 0 ) {
+		throw std::runtime_error("Not a QOI file");
+	}
+	const auto width = get_u32(header + 4);
+	const auto height = get_u32(header + 8);
+	if( width == 0 || height == 0 || static_cast<std::uint64_t>(width) * height > max_pixels ) {
+		throw std::runtime_error("Bad QOI size " + std::to_string(width) + "x" + std::to_string(height));
+	}
+	if( (header[12] != 3 && header[12] != 4) || header[13] > 1 ) { throw std::runtime_error("Bad QOI channels"); }
+
+	// Read everything that's left, a chunk at a time since the stream might not be able to say how much there is
+	auto data = std::vector<std::uint8_t>{};
+	constexpr auto chunk = std::size_t{1} << 20;
+	while( is ) {
+		const auto done = data.size();
+		data.resize(done + chunk);
+		is.read(reinterpret_cast<char *>(data.data() + done), chunk);
+		data.resize(done + static_cast<std::size_t>(is.gcount()));
+	}
+
+	auto image = ppm_image{image_size{static_cast<int>(width), static_cast<int>(height)},
+						   rgb_pixel::get_colour(rgb_pixel::colours::BLACK)};
+	auto *pixels = image.view().data();
+	const auto total = static_cast<std::size_t>(width) * height;
+	auto seen = std::array<std::uint32_t, 64>{};
+	auto pixel = pack(0, 0, 0, 0xff);
+	auto most = std::uint8_t{0};
+	const auto *in = data.data();
+	const auto *end = in + data.size();
+	const auto need = [&](const std::ptrdiff_t bytes) {
+		if( end - in < bytes ) { throw std::runtime_error("The QOI file is cut short"); }
+	};
+
+	for( std::size_t i = 0; i < total; ) {
+		need(1);
+		const auto op = *in++;
+		auto run = std::size_t{1};
+		if( op == op_rgb ) {
+			need(3);
+			pixel = pack(in[0], in[1], in[2], channel(pixel, 3));
+			in += 3;
+		}
+		else if( op == op_rgba ) {
+			need(4);
+			pixel = pack(in[0], in[1], in[2], in[3]);
+			in += 4;
+		}
+		else if( (op & op_mask) == op_index ) {
+			pixel = seen[op];
+		}
+		else if( (op & op_mask) == op_diff ) {
+			pixel = pack(static_cast<std::uint8_t>(channel(pixel, 0) + ((op >> 4) & 3) - 2),
+						 static_cast<std::uint8_t>(channel(pixel, 1) + ((op >> 2) & 3) - 2),
+						 static_cast<std::uint8_t>(channel(pixel, 2) + (op & 3) - 2), channel(pixel, 3));
+		}
+		else if( (op & op_mask) == op_luma ) {
+			need(1);
+			const auto dg = (op & 0x3f) - 32;
+			const auto next = *in++;
+			pixel = pack(static_cast<std::uint8_t>(channel(pixel, 0) + dg + (next >> 4) - 8),
+						 static_cast<std::uint8_t>(channel(pixel, 1) + dg),
+						 static_cast<std::uint8_t>(channel(pixel, 2) + dg + (next & 0xf) - 8), channel(pixel, 3));
+		}
+		else {
+			run = std::min<std::size_t>((op & 0x3f) + 1, total - i);
+		}
+		seen[seen_slot(pixel)] = pixel;
+
+		const auto rgb = rgb_pixel{channel(pixel, 0), channel(pixel, 1), channel(pixel, 2)};
+		std::fill(pixels + i, pixels + i + run, rgb);
+		most = std::max({most, rgb.red(), rgb.green(), rgb.blue()});
+		i += run;
+	}
+
+	image.max_colour() = most;
+	return image;
+}
@@ -0,0 +1,76 @@
+#ifndef SONGSIM_QOI_H
+#define SONGSIM_QOI_H
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "ppm_file.h"
+
+/*!
+ * @brief Writes a QOI (Quite OK Image) file a row at a time, like ppm_writer.
+ * Runs of the same pixel, as in the white of a SongSim image, take a byte per 62 pixels, and the
+ * encoder only looks at each pixel once, so it's nearly as fast as writing a P6.
+ * Runs carry on from one row to the next, and the file is finished when the last row is written.
+ */
+class qoi_writer
+{
+public:
+	/*!
+	 * @brief Write the header
+	 * @param os The stream destination, which must outlive the writer
+	 * @param size The dimensions of the image, which can't be empty
+	 * @throw std::runtime_error if the image is empty
+	 */
+	qoi_writer(std::ostream& os, const image_size& size);
+
+	/*!
+	 * @brief Write the next row.
+	 * Short rows are padded with white pixels, as ppm_writer does.
+	 * @param row The pixels
+	 * @param count How many pixels there are
+	 * @throw std::runtime_error if every row's already been written
+	 */
+	void write_row(const rgb_pixel* row, std::size_t count);
+
+	/*!
+	 * @brief Write the next row
+	 * @param row The pixels
+	 */
+	void write_row(const ppm_image::const_line_type& row) { write_row(row.data(), row.size()); }
+
+	/*!
+	 * @brief The same hash of the rows written so far as ppm_writer::pixel_hash
+	 */
+	std::uint64_t pixel_hash() const { return _hash.digest(); }
+
+private:
+	std::ostream& 					_os;
+	image_size 						_size;
+	int 							_rows{0};			/*! Rows written so far 							*/
+	std::uint32_t 					_previous;			/*! The last pixel encoded, packed as RGBA 			*/
+	int 							_run{0};			/*! How many times it's been repeated since 		*/
+	std::array<std::uint32_t, 64> 	_seen{};			/*! Recent pixels, packed, by their QOI hash 		*/
+	std::vector<std::uint8_t> 		_buffer;			/*! Big enough for a row at worst 					*/
+	xxh64 							_hash;
+
+	std::uint8_t* _encode(const rgb_pixel* row, std::size_t count, std::uint8_t* out);
+};
+
+/*!
+ * @brief Write the pixels of a view as a QOI file
+ * @param os The stream destination
+ * @param v The pixels to write, which can't be empty
+ * @return The hash of the pixels written, the same as image_hash(v)
+ */
+std::uint64_t write_qoi(std::ostream& os, const image_view& v);
+
+/*!
+ * @brief Read a QOI file. Any alpha channel is dropped.
+ * @param is The stream to read from, which should be binary
+ * @return The image, with the max colour the most of any channel
+ * @throw std::runtime_error if it isn't a QOI file or it's cut short
+ */
+ppm_image read_qoi(std::istream& is);
+
+#endif //SONGSIM_QOI_H
@@ -0,0 +1,283 @@
+#include "quantise.h"
+#include "parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/*! Bits of each channel the histogram for median cut is counted at */
+constexpr auto histogram_bits = 5;
+/*! Bits of each channel the nearest colour table is looked up at */
+constexpr auto nearest_bits = 6;
+/*! Roughly the most pixels median cut counts */
+constexpr auto most_samples = std::uint64_t{1} << 20;
+
+/*!
+ * @brief The pixels counted in one cell of the histogram
+ */
+struct colour_count {
+	std::array<int, 3> 				cell{};		/*! The cell's red, green and blue 	*/
+	std::uint64_t 					count{0};
+	std::array<std::uint64_t, 3> 	sums{};		/*! Of each channel of the pixels 	*/
+};
+
+/*!
+ * @brief A range of the counts, which median cut halves until there are enough
+ */
+struct colour_box {
+	std::size_t 	first{0};
+	std::size_t 	last{0};
+	std::uint64_t 	count{0};
+	int 			axis{0};		/*! The channel the cells are most spread out along 	*/
+	int 			spread{0};		/*! How far they're spread along it 					*/
+};
+
+colour_box make_box(const std::vector<colour_count> &counts, const std::size_t first, const std::size_t last) {
+	auto box = colour_box{first, last};
+	auto low = std::array<int, 3>{INT32_MAX, INT32_MAX, INT32_MAX};
+	auto high = std::array<int, 3>{};
+	for( auto i = first; i < last; i++ ) {
+		box.count += counts[i].count;
+		for( auto c = 0; c < 3; c++ ) {
+			low[c] = std::min(low[c], counts[i].cell[c]);
+			high[c] = std::max(high[c], counts[i].cell[c]);
+		}
+	}
+	for( auto c = 0; c < 3; c++ ) {
+		if( high[c] - low[c] > box.spread ) {
+			box.spread = high[c] - low[c];
+			box.axis = c;
+		}
+	}
+	return box;
+}
+
+std::vector<colour_count> count_colours(const image_view &image, const unsigned threads) {
+	constexpr auto cells = 1 << (3 * histogram_bits);
+	constexpr auto shift = 8 - histogram_bits;
+	const auto pixels = static_cast<std::uint64_t>(image.size().width()) * static_cast<std::uint64_t>(image.size().height());
+	const auto step = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(pixels) / most_samples)));
+	const auto rows = (image.size().height() + step - 1) / step;
+
+	auto bands = std::vector<std::vector<colour_count>>(static_cast<std::size_t>(band_count(rows, threads)));
+	parallel_bands(rows, threads, [&](const int first, const int last, const int band) {
+		auto &histogram = bands[band];
+		histogram.resize(cells);
+		for( auto r = first; r < last; r++ ) {
+			const auto row = image[r * step];
+			for( std::size_t x = 0; x < row.size(); x += step ) {
+				const auto &p = row[x];
+				auto &cell = histogram[(p.red() >> shift) << (2 * histogram_bits) | (p.green() >> shift) << histogram_bits |
+									   p.blue() >> shift];
+				cell.count++;
+				cell.sums[0] += p.red();
+				cell.sums[1] += p.green();
+				cell.sums[2] += p.blue();
+			}
+		}
+	});
+
+	auto counts = std::vector<colour_count>{};
+	for( auto i = 0; i < cells; i++ ) {
+		auto total = colour_count{};
+		for( const auto &histogram: bands ) {
+			total.count += histogram[i].count;
+			for( auto c = 0; c < 3; c++ ) { total.sums[c] += histogram[i].sums[c]; }
+		}
+		if( !total.count ) { continue; }
+		total.cell = {i >> (2 * histogram_bits), (i >> histogram_bits) & ((1 << histogram_bits) - 1),
+					  i & ((1 << histogram_bits) - 1)};
+		counts.push_back(total);
+	}
+	return counts;
+}
+
+/*!
+ * @brief The nearest palette colour to every colour, at nearest_bits a channel
+ */
+class nearest_table {
+public:
+	nearest_table(const std::vector<rgb_pixel> &palette, const unsigned threads)
+			: _indices(std::size_t{1} << (3 * nearest_bits)) {
+		constexpr auto levels = 1 << nearest_bits;
+		constexpr auto half = 1 << (shift - 1);
+		parallel_bands(levels, threads, [&](const int first, const int last, int) {
+			for( auto r = first; r < last; r++ ) {
+				for( auto g = 0; g < levels; g++ ) {
+					for( auto b = 0; b < levels; b++ ) {
+						_indices[_key(r, g, b)] = nearest(palette, (r << shift) + half, (g << shift) + half, (b << shift) + half);
+					}
+				}
+			}
+		});
+	}
+
+	std::uint8_t operator()(const int r, const int g, const int b) const {
+		return _indices[_key(r >> shift, g >> shift, b >> shift)];
+	}
+
+	static std::uint8_t nearest(const std::vector<rgb_pixel> &palette, const int r, const int g, const int b) {
+		auto best = std::size_t{0};
+		auto best_distance = INT32_MAX;
+		for( std::size_t i = 0; i < palette.size(); i++ ) {
+			const auto dr = r - palette[i].red();
+			const auto dg = g - palette[i].green();
+			const auto db = b - palette[i].blue();
+			const auto distance = dr * dr + dg * dg + db * db;
+			if( distance < best_distance ) {
+				best_distance = distance;
+				best = i;
+			}
+		}
+		return static_cast<std::uint8_t>(best);
+	}
+
+private:
+	static constexpr auto shift = 8 - nearest_bits;
+	std::vector<std::uint8_t> _indices;
+
+	static std::size_t _key(const int r, const int g, const int b) {
+		return static_cast<std::size_t>(r << (2 * nearest_bits) | g << nearest_bits | b);
+	}
+};
+
+/*!
+ * @brief The 8x8 Bayer matrix, as offsets to add to a channel of a palette spread out by spread
+ */
+std::array<std::array<int, 8>, 8> bayer_offsets(const int spread) {
+	auto offsets = std::array<std::array<int, 8>, 8>{};
+	for( auto y = 0; y < 8; y++ ) {
+		for( auto x = 0; x < 8; x++ ) {
+			// Interleave the bits of x ^ y and y, most significant first
+			const auto a = x ^ y;
+			const auto rank = (a & 1) << 5 | (y & 1) << 4 | (a & 2) << 2 | (y & 2) << 1 | (a & 4) >> 1 | (y & 4) >> 2;
+			offsets[y][x] = static_cast<int>(std::lround(((rank + 0.5) / 64 - 0.5) * spread));
+		}
+	}
+	return offsets;
+}
+
+void floyd_steinberg(const image_view &image, const std::vector<rgb_pixel> &palette, const nearest_table &nearest,
+					 indexed_image &out) {
+	const auto width = image.size().width();
+	// The error carried onto this row and the next, with a pixel either side so the edges need no checks
+	auto current = std::vector<std::array<int, 3>>(static_cast<std::size_t>(width) + 2);
+	auto next = current;
+	for( auto y = 0; y < image.size().height(); y++ ) {
+		const auto row = image[y];
+		auto *indices = &out.indices[static_cast<std::size_t>(y) * static_cast<std::size_t>(width)];
+		std::fill(next.begin(), next.end(), std::array<int, 3>{});
+		for( auto x = 0; x < width; x++ ) {
+			const auto &p = row[x];
+			const auto &carried = current[x + 1];
+			// The error is kept in sixteenths
+			const auto want = std::array<int, 3>{
+					std::clamp(p.red() + (carried[0] + 8) / 16, 0, 255),
+					std::clamp(p.green() + (carried[1] + 8) / 16, 0, 255),
+					std::clamp(p.blue() + (carried[2] + 8) / 16, 0, 255)};
+			const auto index = nearest(want[0], want[1], want[2]);
+			indices[x] = index;
+			const auto &got = palette[index];
+			const auto error = std::array<int, 3>{want[0] - got.red(), want[1] - got.green(), want[2] - got.blue()};
+			for( auto c = 0; c < 3; c++ ) {
+				current[x + 2][c] += error[c] * 7;
+				next[x][c] += error[c] * 3;
+				next[x + 1][c] += error[c] * 5;
+				next[x + 2][c] += error[c];
+			}
+		}
+		std::swap(current, next);
+	}
+}
+
+}
+
+ppm_image indexed_image::to_ppm() const {
+	auto p = ppm_image{size, rgb_pixel{}};
+	for( auto y = 0; y < size.height(); y++ ) {
+		const auto row = p[y];
+		for( auto x = 0; x < size.width(); x++ ) { row[x] = palette[index(x, y)]; }
+	}
+	p.max_colour() = UINT8_MAX;
+	return p;
+}
+
+std::vector<rgb_pixel> median_cut(const image_view &image, const int colours, const unsigned threads) {
+	if( colours < 1 || colours > 256 ) { throw std::runtime_error("A palette has from 1 to 256 colours"); }
+	if( image.empty()) { return {}; }
+
+	auto counts = count_colours(image, threads);
+	auto boxes = std::vector<colour_box>{make_box(counts, 0, counts.size())};
+	while( boxes.size() < static_cast<std::size_t>(colours)) {
+		// Halve the box with the most pixels spread furthest, so busy areas get the most colours
+		const auto widest = std::max_element(boxes.begin(), boxes.end(), [](const colour_box &a, const colour_box &b) {
+			return a.count * a.spread < b.count * b.spread;
+		});
+		if( widest->spread == 0 ) { break; }
+
+		const auto box = *widest;
+		const auto first = counts.begin() + static_cast<std::ptrdiff_t>(box.first);
+		const auto last = counts.begin() + static_cast<std::ptrdiff_t>(box.last);
+		std::sort(first, last, [&](const colour_count &a, const colour_count &b) { return a.cell[box.axis] < b.cell[box.axis]; });
+		// Split after the cell which takes the count to half, leaving at least one cell on each side
+		auto split = box.first;
+		auto seen = std::uint64_t{0};
+		while( split < box.last - 1 ) {
+			seen += counts[split++].count;
+			if( seen >= box.count / 2 ) { break; }
+		}
+		*widest = make_box(counts, box.first, split);
+		boxes.push_back(make_box(counts, split, box.last));
+	}
+
+	auto palette = std::vector<rgb_pixel>{};
+	for( const auto &box: boxes ) {
+		auto sums = std::array<std::uint64_t, 3>{};
+		for( auto i = box.first; i < box.last; i++ ) {
+			for( auto c = 0; c < 3; c++ ) { sums[c] += counts[i].sums[c]; }
+		}
+		const auto mean = [&](const int c) { return static_cast<std::uint8_t>((sums[c] + box.count / 2) / box.count); };
+		palette.emplace_back(mean(0), mean(1), mean(2));
+	}
+	return palette;
+}
+
+indexed_image quantise(const image_view &image, const std::vector<rgb_pixel> &palette, const dither d,
+					   const unsigned threads) {
+	if( palette.empty() || palette.size() > 256 ) { throw std::runtime_error("A palette has from 1 to 256 colours"); }
+	auto out = indexed_image{image.size(), palette, {}};
+	out.indices.resize(static_cast<std::size_t>(std::max(image.size().width(), 0)) *
+					   static_cast<std::size_t>(std::max(image.size().height(), 0)));
+	if( image.empty()) { return out; }
+
+	const auto nearest = nearest_table{palette, threads};
+	if( d == dither::FLOYD_STEINBERG ) {
+		floyd_steinberg(image, palette, nearest, out);
+		return out;
+	}
+
+	// The pattern spans about the gap between neighbouring colours of an evenly spread palette
+	const auto offsets = bayer_offsets(d == dither::ORDERED ? static_cast<int>(256 / std::cbrt(palette.size())) : 0);
+	const auto width = static_cast<std::size_t>(image.size().width());
+	parallel_bands(image.size().height(), threads, [&](const int first, const int last, int) {
+		for( auto y = first; y < last; y++ ) {
+			const auto row = image[y];
+			const auto &pattern = offsets[y & 7];
+			auto *indices = &out.indices[static_cast<std::size_t>(y) * width];
+			for( std::size_t x = 0; x < width; x++ ) {
+				const auto &p = row[x];
+				const auto offset = pattern[x & 7];
+				indices[x] = nearest(std::clamp(p.red() + offset, 0, 255), std::clamp(p.green() + offset, 0, 255),
+									 std::clamp(p.blue() + offset, 0, 255));
+			}
+		}
+	});
+	return out;
+}
+
+indexed_image quantise(const image_view &image, const int colours, const dither d, const unsigned threads) {
+	return quantise(image, median_cut(image, colours, threads), d, threads);
+}
@@ -0,0 +1,70 @@
+#ifndef SONGSIM_QUANTISE_H
+#define SONGSIM_QUANTISE_H
+
+#include <cstdint>
+#include <vector>
+#include "ppm_file.h"
+
+/*!
+ * @brief An image whose pixels are each an index into a palette of at most 256 colours
+ */
+struct indexed_image {
+	image_size 					size;
+	std::vector<rgb_pixel> 		palette;
+	std::vector<std::uint8_t> 	indices;	/*! One per pixel, a row at a time from the top left 	*/
+
+	/*!
+	 * @brief The palette index of a pixel
+	 */
+	std::uint8_t index(const int x, const int y) const {
+		return indices[static_cast<std::size_t>(y) * static_cast<std::size_t>(size.width()) + static_cast<std::size_t>(x)];
+	}
+
+	/*!
+	 * @brief Look every pixel up in the palette to get an image which can be written
+	 */
+	ppm_image to_ppm() const;
+};
+
+/*!
+ * @brief How quantise picks the palette colour for each pixel
+ */
+enum class dither {
+	NONE,				/*! The nearest colour, which bands smooth gradients 							*/
+	ORDERED,			/*! The nearest colour after adding an 8x8 Bayer pattern, done on bands of rows 	*/
+	FLOYD_STEINBERG		/*! Spreading each pixel's error onto the ones after it, the best but one thread 	*/
+};
+
+/*!
+ * @brief Choose a palette for an image with median cut.
+ * The pixels are counted into a histogram of 32 levels a channel, sampling at most about a million of
+ * them, and the box of colours with the most pixels and widest spread is halved at its median until
+ * there are enough boxes. Each colour is the mean of the pixels in its box.
+ * @param image The pixels to choose colours for
+ * @param colours The most colours to choose, from 1 to 256
+ * @param threads How many threads to count the histogram with, 0 means one per hardware thread
+ * @return The palette, which has fewer colours if the image does
+ */
+std::vector<rgb_pixel> median_cut(const image_view& image, int colours, unsigned threads = 1);
+
+/*!
+ * @brief Map each pixel to a colour of a palette.
+ * The nearest colour is looked up in a table of 64 levels a channel, built once for the palette.
+ * @param image The pixels to map
+ * @param palette The colours to use, at most 256
+ * @param d How to dither
+ * @param threads How many threads to use for NONE and ORDERED, 0 means one per hardware thread
+ */
+indexed_image quantise(const image_view& image, const std::vector<rgb_pixel>& palette, dither d,
+					   unsigned threads = 1);
+
+/*!
+ * @brief Reduce an image to a median cut palette of its own colours
+ * @param image The pixels to reduce
+ * @param colours The most colours to use, from 1 to 256
+ * @param d How to dither
+ * @param threads How many threads to use, 0 means one per hardware thread
+ */
+indexed_image quantise(const image_view& image, int colours, dither d, unsigned threads = 1);
+
+#endif //SONGSIM_QUANTISE_H
@@ -0,0 +1,222 @@
+#include "resize.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/*! The weights of each pass add up to one in this many bits of fixed point */
+constexpr auto weight_bits = 14;
+/*! Bits of the column pass's result kept for the row pass, beyond the 8 of a channel */
+constexpr auto extra_bits = 8;
+
+/*!
+ * @brief Which old pixels along one axis make up each new pixel, and how much of each
+ */
+struct taps {
+	std::vector<int> 			first;		/*! The first old pixel of each new pixel 					*/
+	std::vector<int> 			count;		/*! How many old pixels from first 						*/
+	std::vector<std::int32_t> 	weights;	/*! most weights for each new pixel, adding up to one 	*/
+	int 						most{0};
+};
+
+/*! Past this many old pixels per new one, 14 bit weights are too coarse and BOX adds up in floating point instead */
+constexpr auto most_fixed_scale = 64;
+
+/*!
+ * @brief Which old pixels along one axis make up each new pixel, and how much of each, adding up to one
+ */
+using spans = std::vector<std::vector<std::pair<int, double>>>;
+
+/*!
+ * @brief Work out the spans for one axis
+ * @param from The number of old pixels
+ * @param to The number of new pixels
+ * @param filter BOX or BILINEAR
+ */
+spans make_spans(const int from, const int to, const resize_filter filter) {
+	const auto scale = static_cast<double>(from) / to;
+	auto result = spans(static_cast<std::size_t>(to));
+	for( auto i = 0; i < to; i++ ) {
+		auto &span = result[i];
+		if( filter == resize_filter::BOX ) {
+			// The old pixels the new one covers, the ones at the edges only partly
+			const auto left = i * scale;
+			const auto right = (i + 1) * scale;
+			for( auto j = static_cast<int>(left); j < std::min(from, static_cast<int>(std::ceil(right))); j++ ) {
+				const auto overlap = std::min<double>(j + 1, right) - std::max<double>(j, left);
+				if( overlap > 0 ) { span.emplace_back(j, overlap); }
+			}
+		}
+		else {
+			// The two old pixels either side of the new one's centre
+			const auto centre = std::clamp((i + 0.5) * scale - 0.5, 0.0, static_cast<double>(from - 1));
+			const auto j = static_cast<int>(centre);
+			const auto f = centre - j;
+			span.emplace_back(j, 1 - f);
+			if( j + 1 < from && f > 0 ) { span.emplace_back(j + 1, f); }
+		}
+
+		auto total = 0.0;
+		for( const auto &tap: span ) { total += tap.second; }
+		for( auto &tap: span ) { tap.second /= total; }
+	}
+	return result;
+}
+
+/*!
+ * @brief Work out the fixed point taps for one axis
+ * @param from The number of old pixels
+ * @param to The number of new pixels, at least from / most_fixed_scale for BOX
+ * @param filter BOX or BILINEAR
+ */
+taps make_taps(const int from, const int to, const resize_filter filter) {
+	const auto spans = make_spans(from, to, filter);
+	auto t = taps{};
+	for( const auto &span: spans ) { t.most = std::max(t.most, static_cast<int>(span.size())); }
+	t.weights.resize(static_cast<std::size_t>(to) * t.most);
+	for( auto i = 0; i < to; i++ ) {
+		const auto &span = spans[i];
+		t.first.push_back(span.front().first);
+		t.count.push_back(static_cast<int>(span.size()));
+
+		// Round each weight, then give whatever rounding lost or gained to the biggest so they add up exactly.
+		// With at most most_fixed_scale + 1 taps that's at most 33, and the biggest is at least 1 / 65 of 16384.
+		auto *w = &t.weights[static_cast<std::size_t>(i) * t.most];
+		auto sum = 0;
+		auto biggest = 0;
+		for( std::size_t k = 0; k < span.size(); k++ ) {
+			w[k] = static_cast<std::int32_t>(std::lround(span[k].second * (1 << weight_bits)));
+			sum += w[k];
+			if( w[k] > w[biggest] ) { biggest = static_cast<int>(k); }
+		}
+		w[biggest] += (1 << weight_bits) - sum;
+	}
+	return t;
+}
+
+void resize_nearest(const image_view &src, const mutable_image_view &dst, const unsigned threads) {
+	const auto columns = [&] {
+		auto c = std::vector<int>(static_cast<std::size_t>(dst.size().width()));
+		for( std::size_t x = 0; x < c.size(); x++ ) {
+			c[x] = static_cast<int>((x + 0.5) * src.size().width() / dst.size().width());
+		}
+		return c;
+	}();
+	parallel_bands(dst.size().height(), threads, [&](const int first, const int last, int) {
+		for( auto y = first; y < last; y++ ) {
+			const auto from = src[static_cast<int>((y + 0.5) * src.size().height() / dst.size().height())];
+			const auto to = dst[y];
+			for( std::size_t x = 0; x < columns.size(); x++ ) { to[x] = from[columns[x]]; }
+		}
+	});
+}
+
+/*!
+ * @brief Scale with BOX or BILINEAR.
+ * Each new row is made by first adding up the old rows it covers, weighted, as one run of bytes that
+ * the compiler can vectorise, then doing the same along that row.
+ */
+void resize_separable(const image_view &src, const mutable_image_view &dst, const resize_filter filter,
+					  const unsigned threads) {
+	const auto across = make_taps(src.size().width(), dst.size().width(), filter);
+	const auto down = make_taps(src.size().height(), dst.size().height(), filter);
+	const auto src_channels = static_cast<std::size_t>(src.size().width()) * 3;
+	constexpr auto column_shift = weight_bits - extra_bits;
+	constexpr auto row_shift = weight_bits + extra_bits;
+
+	parallel_bands(dst.size().height(), threads, [&](const int first, const int last, int) {
+		auto sums = std::vector<std::int32_t>(src_channels);
+		auto column = std::vector<std::uint16_t>(src_channels);
+		for( auto y = first; y < last; y++ ) {
+			// Down the columns
+			std::fill(sums.begin(), sums.end(), 1 << (column_shift - 1));
+			const auto *wy = &down.weights[static_cast<std::size_t>(y) * down.most];
+			for( auto k = 0; k < down.count[y]; k++ ) {
+				const auto *in = reinterpret_cast<const std::uint8_t *>(src[down.first[y] + k].data());
+				// Both fit in 16 bits, which lets the compiler use the 16 bit multiplies
+				const auto w = static_cast<std::int16_t>(wy[k]);
+				for( std::size_t c = 0; c < src_channels; c++ ) { sums[c] += static_cast<std::int16_t>(in[c]) * w; }
+			}
+			for( std::size_t c = 0; c < src_channels; c++ ) {
+				column[c] = static_cast<std::uint16_t>(sums[c] >> column_shift);
+			}
+
+			// Along the row
+			auto *out = reinterpret_cast<std::uint8_t *>(dst[y].data());
+			for( auto x = 0; x < dst.size().width(); x++ ) {
+				const auto *wx = &across.weights[static_cast<std::size_t>(x) * across.most];
+				const auto *in = &column[static_cast<std::size_t>(across.first[x]) * 3];
+				std::uint32_t r = 1u << (row_shift - 1), g = r, b = r;
+				for( auto k = 0; k < across.count[x]; k++ ) {
+					const auto w = static_cast<std::uint32_t>(wx[k]);
+					r += in[k * 3] * w;
+					g += in[k * 3 + 1] * w;
+					b += in[k * 3 + 2] * w;
+				}
+				out[x * 3] = static_cast<std::uint8_t>(std::min(r >> row_shift, 255u));
+				out[x * 3 + 1] = static_cast<std::uint8_t>(std::min(g >> row_shift, 255u));
+				out[x * 3 + 2] = static_cast<std::uint8_t>(std::min(b >> row_shift, 255u));
+			}
+		}
+	});
+}
+
+/*!
+ * @brief Scale a long way down with BOX, adding up the exact share of every old pixel in doubles.
+ * It's slower per old pixel than the fixed point, but there are few new pixels to work out.
+ */
+void resize_area(const image_view &src, const mutable_image_view &dst, const unsigned threads) {
+	const auto across = make_spans(src.size().width(), dst.size().width(), resize_filter::BOX);
+	const auto down = make_spans(src.size().height(), dst.size().height(), resize_filter::BOX);
+	const auto src_channels = static_cast<std::size_t>(src.size().width()) * 3;
+
+	parallel_bands(dst.size().height(), threads, [&](const int first, const int last, int) {
+		auto column = std::vector<double>(src_channels);
+		for( auto y = first; y < last; y++ ) {
+			std::fill(column.begin(), column.end(), 0.0);
+			for( const auto &tap: down[y] ) {
+				const auto *in = reinterpret_cast<const std::uint8_t *>(src[tap.first].data());
+				for( std::size_t c = 0; c < src_channels; c++ ) { column[c] += in[c] * tap.second; }
+			}
+
+			auto *out = reinterpret_cast<std::uint8_t *>(dst[y].data());
+			for( auto x = 0; x < dst.size().width(); x++ ) {
+				double sum[3] = {0, 0, 0};
+				for( const auto &tap: across[x] ) {
+					for( auto c = 0; c < 3; c++ ) { sum[c] += column[static_cast<std::size_t>(tap.first) * 3 + c] * tap.second; }
+				}
+				for( auto c = 0; c < 3; c++ ) {
+					out[x * 3 + c] = static_cast<std::uint8_t>(std::clamp<long>(std::lround(sum[c]), 0, 255));
+				}
+			}
+		}
+	});
+}
+
+}
+
+void resize(const image_view &src, const mutable_image_view &dst, const resize_filter filter, const unsigned threads) {
+	static_assert(sizeof(rgb_pixel) == 3, "Rows of pixels are scaled as runs of bytes");
+	if( src.empty() || dst.empty()) { return; }
+	if( filter == resize_filter::NEAREST ) {
+		resize_nearest(src, dst, threads);
+	}
+	else if( filter == resize_filter::BOX && (src.size().width() > dst.size().width() * most_fixed_scale ||
+											  src.size().height() > dst.size().height() * most_fixed_scale)) {
+		resize_area(src, dst, threads);
+	}
+	else {
+		resize_separable(src, dst, filter, threads);
+	}
+}
+
+ppm_image resize(const ppm_image &src, const image_size &size, const resize_filter filter, const unsigned threads) {
+	auto dst = ppm_image{size, rgb_pixel{}};
+	resize(src.view(), dst.view(), filter, threads);
+	dst.max_colour() = src.max_colour();
+	return dst;
+}
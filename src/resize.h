@@ -0,0 +1,36 @@
+#ifndef SONGSIM_RESIZE_H
+#define SONGSIM_RESIZE_H
+
+#include "ppm_file.h"
+
+/*!
+ * @brief How resize works out each new pixel from the old ones
+ */
+enum class resize_filter {
+	NEAREST,	/*! The old pixel under the centre of the new one, fastest but blocky 				*/
+	BOX,		/*! The average of the old pixels the new one covers, the best for shrinking 		*/
+	BILINEAR	/*! Blended from the four old pixels nearest its centre, the best for enlarging 	*/
+};
+
+/*!
+ * @brief Scale the pixels of one view to fill another.
+ * The box and bilinear filters run as two separable passes, down the columns and then along the rows,
+ * in fixed point, over bands of the destination rows on their own threads.
+ * @param src The pixels to scale
+ * @param dst Where to put them, its size is the size they're scaled to
+ * @param filter How to work out each new pixel
+ * @param threads How many threads to use, 0 means one per hardware thread
+ */
+void resize(const image_view& src, const mutable_image_view& dst, resize_filter filter, unsigned threads = 1);
+
+/*!
+ * @brief Scale an image
+ * @param src The image to scale
+ * @param size The size to scale it to
+ * @param filter How to work out each new pixel
+ * @param threads How many threads to use, 0 means one per hardware thread
+ * @return The scaled image, with the same max colour value as src
+ */
+ppm_image resize(const ppm_image& src, const image_size& size, resize_filter filter, unsigned threads = 1);
+
+#endif //SONGSIM_RESIZE_H
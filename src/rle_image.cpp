@@ -0,0 +1,95 @@
+#include "rle_image.h"
+#include <algorithm>
+
+namespace {
+
+/*!
+ * @brief The run a column is in, the first one ending after it
+ */
+rle_image::row_type::iterator find_run(rle_image::row_type &row, const int x) {
+	return std::upper_bound(row.begin(), row.end(), x, [](const int col, const rle_image::run &r) { return col < r.end; });
+}
+
+}
+
+rle_image::rle_image(const image_size &size, const rgb_pixel &fill, std::pmr::memory_resource *resource)
+		: _size(size), _rows(static_cast<std::size_t>(std::max(size.height(), 0)), resource) {
+	if( size.width() <= 0 ) { return; }
+	for( auto &row: _rows ) { row.push_back(run{size.width(), fill}); }
+}
+
+uint8_t rle_image::max_colour() const {
+	auto most = uint8_t{0};
+	for( const auto &row: _rows ) {
+		for( const auto &r: row ) { most = std::max({most, r.colour.red(), r.colour.green(), r.colour.blue()}); }
+	}
+	return most;
+}
+
+std::size_t rle_image::run_count() const {
+	auto count = std::size_t{0};
+	for( const auto &row: _rows ) { count += row.size(); }
+	return count;
+}
+
+rgb_pixel rle_image::at(const int x, const int y) const {
+	const auto &row = _rows[static_cast<std::size_t>(y)];
+	return std::upper_bound(row.begin(), row.end(), x, [](const int col, const run &r) { return col < r.end; })->colour;
+}
+
+void rle_image::set(const int x, const int y, const rgb_pixel &colour) {
+	auto &row = _rows[static_cast<std::size_t>(y)];
+	const auto it = find_run(row, x);
+	if( it->colour == colour ) { return; }
+
+	const auto start = it == row.begin() ? 0 : std::prev(it)->end;
+	const auto has_prev = it != row.begin() && std::prev(it)->colour == colour;
+	const auto has_next = std::next(it) != row.end() && std::next(it)->colour == colour;
+	if( it->end - start == 1 ) {
+		// The run is just this pixel, so recolour it, then fold it into a neighbour of the same colour
+		it->colour = colour;
+		if( has_next ) {
+			const auto merged = row.erase(it);
+			if( has_prev ) { std::prev(merged)->end = merged->end; row.erase(merged); }
+		}
+		else if( has_prev ) {
+			std::prev(it)->end = it->end;
+			row.erase(it);
+		}
+	}
+	else if( x == start ) {
+		// The first pixel of the run moves to the one before it, or becomes a run of its own
+		if( has_prev ) { std::prev(it)->end++; }
+		else { row.insert(it, run{x + 1, colour}); }
+	}
+	else if( x == it->end - 1 ) {
+		// Likewise the last
+		it->end--;
+		if( !has_next ) { row.insert(std::next(it), run{x + 1, colour}); }
+	}
+	else {
+		// From the middle, leaving the run either side of it
+		const auto old = it->colour;
+		row.insert(it, {run{x, old}, run{x + 1, colour}});
+	}
+}
+
+void rle_image::expand_row(const int y, rgb_pixel *out) const {
+	auto start = 0;
+	for( const auto &r: _rows[static_cast<std::size_t>(y)] ) {
+		std::fill(out + start, out + r.end, r.colour);
+		start = r.end;
+	}
+}
+
+std::uint64_t rle_image::write(std::ostream &os, const ppm_image::format f, const std::string &comment) const {
+	auto writer = ppm_writer{os, _size, max_colour(), f, comment};
+	return write_to(writer);
+}
+
+ppm_image rle_image::to_ppm() const {
+	auto p = ppm_image{_size, rgb_pixel{}, _rows.get_allocator().resource()};
+	for( auto y = 0; y < _size.height(); y++ ) { expand_row(y, p[y].data()); }
+	p.max_colour() = max_colour();
+	return p;
+}
@@ -0,0 +1,116 @@
+#ifndef SONGSIM_RLE_IMAGE_H
+#define SONGSIM_RLE_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "ppm_file.h"
+
+/*!
+ * @brief An image held as runs of the same pixel along each row, for images which are mostly one colour.
+ * Memory grows with how many runs there are rather than with the area, and setting a pixel splits the run
+ * it's in. Rows are only expanded to pixels one at a time as they're written out.
+ */
+class rle_image {
+public:
+	/*!
+	 * @brief Some pixels of the same colour, following on from the run before
+	 */
+	struct run {
+		int 		end{0};		/*! One past the last column of the run 	*/
+		rgb_pixel 	colour;
+	};
+
+	using row_type = std::pmr::vector<run>;
+
+	rle_image() = default;
+
+	/*!
+	 * @brief Create an image of a fixed size with every pixel the same colour, one run per row
+	 * @param size The dimensions of the image
+	 * @param fill The colour of every pixel
+	 * @param resource Where the runs are allocated from, to count or pool the allocations
+	 */
+	rle_image(const image_size& size, const rgb_pixel& fill,
+			  std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	const image_size& 	size() const 		{ return _size; }
+
+	/*!
+	 * @brief The most of any channel of any run, worked out from the runs so set() has nothing shared to update
+	 */
+	uint8_t max_colour() const;
+
+	/*!
+	 * @brief The runs of a row, in order, the last ending at the width
+	 * @param y The row, which must be in the image
+	 */
+	const row_type& 	runs(const int y) const	{ return _rows[static_cast<std::size_t>(y)]; }
+
+	/*!
+	 * @brief How many runs there are in every row together
+	 */
+	std::size_t run_count() const;
+
+	/*!
+	 * @brief The pixel at a point, found by a binary search of the row's runs
+	 * @param x The column, which must be in the image
+	 * @param y The row, which must be in the image
+	 */
+	rgb_pixel at(int x, int y) const;
+
+	/*!
+	 * @brief Set the pixel at a point, splitting the run it's in, or joining it to its neighbours.
+	 * Rows only ever touched by one thread at a time can be set from several threads at once.
+	 * Setting pixels from left to right along a row only moves the runs after them, so it's cheap.
+	 * @param x The column, which must be in the image
+	 * @param y The row, which must be in the image
+	 * @param colour The colour to give it
+	 */
+	void set(int x, int y, const rgb_pixel& colour);
+
+	/*!
+	 * @brief Expand a row to pixels
+	 * @param y The row, which must be in the image
+	 * @param out Where to put the pixels, room for the width of the image
+	 */
+	void expand_row(int y, rgb_pixel* out) const;
+
+	/*!
+	 * @brief Feed every row to a row writer, like ppm_writer, png_writer or qoi_writer, one row expanded at a time
+	 * @param writer The writer, made for an image of this size
+	 * @return The writer's hash of the pixels
+	 */
+	template<typename Writer>
+	std::uint64_t write_to(Writer& writer) const {
+		auto row = std::vector<rgb_pixel>(static_cast<std::size_t>(std::max(_size.width(), 0)));
+		for( auto y = 0; y < _size.height(); y++ ) {
+			expand_row(y, row.data());
+			writer.write_row(row.data(), row.size());
+		}
+		return writer.pixel_hash();
+	}
+
+	/*!
+	 * @brief Write out the image data, including header, as ppm_image::write does
+	 * @param os The stream destination
+	 * @param f The flavour of file to write
+	 * @param comment Put in the header as a comment, if it isn't empty
+	 * @return The hash of the pixels written, the same as image_hash of the expanded image
+	 */
+	std::uint64_t write(std::ostream& os, ppm_image::format f, const std::string& comment = {}) const;
+
+	/*!
+	 * @brief Expand the whole image
+	 */
+	ppm_image to_ppm() const;
+
+private:
+	image_size 						_size;
+	std::pmr::vector<row_type> 		_rows;
+};
+
+#endif //SONGSIM_RLE_IMAGE_H
@@ -0,0 +1,145 @@
+#include "transform.h"
+#include "parallel.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/*! The width and height of the tiles, 12KB of pixels each so a tile of both views fits in the L1 cache */
+constexpr auto tile = 64;
+
+/*!
+ * @brief Copy src to dst with its rows and columns swapped, and either of them reversed as well.
+ * Each row of dst comes from a column of src, so it's done in tiles to read each cache line of src once
+ * rather than once for every row of dst.
+ * @param reverse_columns Take the columns of src from the right, turning it anticlockwise
+ * @param reverse_rows Take the rows of src from the bottom, turning it clockwise
+ */
+void swap_axes(const image_view &src, const mutable_image_view &dst, const bool reverse_columns,
+			   const bool reverse_rows, const unsigned threads) {
+	if( dst.size() != image_size{src.size().height(), src.size().width()} ) {
+		throw std::runtime_error("Can't turn a " + std::to_string(src.size().width()) + "x" +
+								 std::to_string(src.size().height()) + " image into one " +
+								 std::to_string(dst.size().width()) + "x" + std::to_string(dst.size().height()));
+	}
+	if( src.empty()) { return; }
+
+	const auto width = dst.size().width();
+	const auto height = dst.size().height();
+	const auto step = reverse_rows ? -src.stride() : src.stride();
+	const auto tile_rows = (height + tile - 1) / tile;
+	parallel_bands(tile_rows, threads, [&](const int first, const int last, int) {
+		for( auto ty = first * tile; ty < std::min(last * tile, height); ty += tile ) {
+			for( auto tx = 0; tx < width; tx += tile ) {
+				const auto right = std::min(tx + tile, width);
+				for( auto y = ty; y < std::min(ty + tile, height); y++ ) {
+					// Row y of dst is column y of src, or counting from the right
+					const auto column = reverse_columns ? src.size().width() - 1 - y : y;
+					const auto row = reverse_rows ? src.size().height() - 1 - tx : tx;
+					const auto *in = src[row].data() + column;
+					auto *out = dst[y].data();
+					for( auto x = tx; x < right; x++, in += step ) { out[x] = *in; }
+				}
+			}
+		}
+	});
+}
+
+void require_square(const mutable_image_view &image) {
+	if( image.size().width() != image.size().height()) {
+		throw std::runtime_error("Only a square image can be transposed or turned a quarter in place");
+	}
+}
+
+}
+
+void transpose(const image_view &src, const mutable_image_view &dst, const unsigned threads) {
+	swap_axes(src, dst, false, false, threads);
+}
+
+void transpose(const mutable_image_view &image) {
+	require_square(image);
+	const auto n = image.size().width();
+	for( auto ty = 0; ty < n; ty += tile ) {
+		// The tile on the diagonal is swapped with itself, the ones to its right with the ones below it
+		for( auto tx = ty; tx < n; tx += tile ) {
+			for( auto y = ty; y < std::min(ty + tile, n); y++ ) {
+				auto row = image[y];
+				for( auto x = std::max(tx, y + 1); x < std::min(tx + tile, n); x++ ) {
+					std::swap(row[x], image[x][y]);
+				}
+			}
+		}
+	}
+}
+
+void rotate(const image_view &src, const mutable_image_view &dst, const rotation r, const unsigned threads) {
+	if( r == rotation::CW_90 ) {
+		swap_axes(src, dst, false, true, threads);
+	}
+	else if( r == rotation::CW_270 ) {
+		swap_axes(src, dst, true, false, threads);
+	}
+	else {
+		if( dst.size() != src.size()) { throw std::runtime_error("Turning an image by half keeps it the same size"); }
+		// Whole rows read backwards into rows from the bottom, which needs no tiles
+		const auto height = src.size().height();
+		parallel_bands(height, threads, [&](const int first, const int last, int) {
+			for( auto y = first; y < last; y++ ) {
+				const auto in = src[height - 1 - y];
+				std::reverse_copy(in.begin(), in.end(), dst[y].begin());
+			}
+		});
+	}
+}
+
+ppm_image rotate(const ppm_image &src, const rotation r, const unsigned threads) {
+	const auto size = r == rotation::CW_180 ? src.size() : image_size{src.size().height(), src.size().width()};
+	auto dst = ppm_image{size, rgb_pixel{}};
+	rotate(src.view(), dst.view(), r, threads);
+	dst.max_colour() = src.max_colour();
+	return dst;
+}
+
+void rotate(const mutable_image_view &image, const rotation r) {
+	if( r == rotation::CW_180 ) {
+		// Reverse each pair of rows from the top and bottom, and swap them, while they're in the cache
+		const auto height = image.size().height();
+		for( auto y = 0; y < height / 2; y++ ) {
+			const auto top = image[y];
+			const auto bottom = image[height - 1 - y];
+			std::reverse(top.begin(), top.end());
+			std::reverse(bottom.begin(), bottom.end());
+			std::swap_ranges(top.begin(), top.end(), bottom.begin());
+		}
+		if( height % 2 ) {
+			const auto middle = image[height / 2];
+			std::reverse(middle.begin(), middle.end());
+		}
+		return;
+	}
+	require_square(image);
+	transpose(image);
+	if( r == rotation::CW_90 ) {
+		flip_horizontal(image);
+	}
+	else {
+		flip_vertical(image);
+	}
+}
+
+void flip_horizontal(const mutable_image_view &image) {
+	for( auto y = 0; y < image.size().height(); y++ ) {
+		const auto row = image[y];
+		std::reverse(row.begin(), row.end());
+	}
+}
+
+void flip_vertical(const mutable_image_view &image) {
+	const auto height = image.size().height();
+	for( auto y = 0; y < height / 2; y++ ) {
+		const auto top = image[y];
+		std::swap_ranges(top.begin(), top.end(), image[height - 1 - y].begin());
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef SONGSIM_TRANSFORM_H
+#define SONGSIM_TRANSFORM_H
+
+#include "ppm_file.h"
+
+/*!
+ * @brief How far to turn an image, clockwise
+ */
+enum class rotation {
+	CW_90,
+	CW_180,
+	CW_270
+};
+
+/*!
+ * @brief Swap the rows and columns of an image, so the pixel at x, y goes to y, x.
+ * It's done a tile at a time so the rows of both views being read and written stay in the cache,
+ * over bands of the destination's rows on their own threads.
+ * @param src The pixels to transpose
+ * @param dst Where to put them, which must be as wide as src is high and as high as it is wide
+ * @param threads How many threads to use, 0 means one per hardware thread
+ * @throw std::runtime_error if dst is the wrong size
+ */
+void transpose(const image_view& src, const mutable_image_view& dst, unsigned threads = 1);
+
+/*!
+ * @brief Transpose a square image in place, swapping each tile above the diagonal with the one below it
+ * @param image The pixels to transpose
+ * @throw std::runtime_error if it isn't square
+ */
+void transpose(const mutable_image_view& image);
+
+/*!
+ * @brief Turn an image, a tile at a time like transpose
+ * @param src The pixels to turn
+ * @param dst Where to put them, which must be the size of src turned
+ * @param r How far to turn it
+ * @param threads How many threads to use, 0 means one per hardware thread
+ * @throw std::runtime_error if dst is the wrong size
+ */
+void rotate(const image_view& src, const mutable_image_view& dst, rotation r, unsigned threads = 1);
+
+/*!
+ * @brief Turn an image
+ * @param src The image to turn
+ * @param r How far to turn it
+ * @param threads How many threads to use, 0 means one per hardware thread
+ * @return The turned image, with the same max colour value as src
+ */
+ppm_image rotate(const ppm_image& src, rotation r, unsigned threads = 1);
+
+/*!
+ * @brief Turn an image in place, which it can only be if it stays the same shape
+ * @param image The pixels to turn
+ * @param r How far to turn it
+ * @throw std::runtime_error if it's turned by a quarter and isn't square
+ */
+void rotate(const mutable_image_view& image, rotation r);
+
+/*!
+ * @brief Mirror an image in place left to right, reversing each row
+ */
+void flip_horizontal(const mutable_image_view& image);
+
+/*!
+ * @brief Mirror an image in place top to bottom, swapping whole rows
+ */
+void flip_vertical(const mutable_image_view& image);
+
+#endif //SONGSIM_TRANSFORM_H
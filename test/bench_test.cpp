@@ -0,0 +1,105 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "compare.h"
+#include <cmath>
+#include <sstream>
+
+/*!
+ * @brief Read results from JSON text
+ */
+static std::vector<bench_result> read(const std::string &json){
+	std::istringstream in{json};
+	return read_results(in);
+}
+
+/*!
+ * @brief A result with the given samples
+ */
+static bench_result result(const std::string &name, const std::vector<double> &samples){
+	bench_result r;
+	r.name = name;
+	r.size = 100;
+	r.samples = samples;
+	return r;
+}
+
+TEST_CASE("Reading results", "[results]"){
+	const auto results{read(R"({"reps": 3, "benchmarks": [
+		{"name": "write_p6", "size": 100, "pixels": 10000, "bytes": 30000, "median": 0.2,
+		 "samples": [0.3, 0.1, 2e-1], "counters": {"cycles": 12}, "fast": true, "note": null},
+		{"name": "png \"strips\"", "size": 50, "median": 0.5}
+	]})")};
+	REQUIRE(results.size() == 2);
+	REQUIRE(results[0].name == "write_p6");
+	REQUIRE(results[0].size == 100);
+	REQUIRE(results[0].pixels == 10000);
+	REQUIRE(results[0].bytes == 30000);
+	REQUIRE(results[0].samples == std::vector<double>{0.3, 0.1, 0.2});
+	REQUIRE(results[0].median() == 0.2);
+
+	// Without samples the median stands in for them
+	REQUIRE(results[1].name == "png \"strips\"");
+	REQUIRE(results[1].samples == std::vector<double>{0.5});
+
+	REQUIRE(read(R"({"benchmarks": []})").empty());
+
+	// Cut short, a bad number, or not benchmark results
+	REQUIRE_THROWS_AS(read(R"({"benchmarks": [{"name": "write_p6", "samples": [0.1)"), std::runtime_error);
+	REQUIRE_THROWS_AS(read(R"({"benchmarks": [{"name": "write_p6)"), std::runtime_error);
+	REQUIRE_THROWS_AS(read(""), std::runtime_error);
+	for( const auto *number: {"1.2.3", "-", "1e", "1e999", "0x10"} ) {
+		REQUIRE_THROWS_AS(read(std::string{R"({"benchmarks": [{"name": "a", "size": )"} + number + "}]}"),
+						  std::runtime_error);
+	}
+	REQUIRE_THROWS_AS(read(R"({"benchmarks": []} x)"), std::runtime_error);
+	REQUIRE_THROWS_AS(read(R"({"results": []})"), std::runtime_error);
+	REQUIRE_THROWS_AS(read(R"({"benchmarks": [{"size": 100}]})"), std::runtime_error);
+}
+
+TEST_CASE("Comparing results", "[compare]"){
+	const std::vector<bench_result> baseline{
+		result("quiet", {1.0, 1.0, 1.0}), result("slower", {1.0, 1.0, 1.0}), result("small", {1.0, 1.0, 1.0}),
+		result("noisy", {0.8, 1.0, 1.2}), result("gone", {1.0})};
+	const std::vector<bench_result> current{
+		result("quiet", {0.9, 0.9, 0.9}), result("slower", {1.1, 1.1, 1.1}), result("small", {1.04, 1.04, 1.04}),
+		result("noisy", {0.9, 1.1, 1.3}), result("new", {2.0})};
+	const auto c{compare_results(baseline, current)};
+
+	// In the baseline's order, then the ones that were added
+	REQUIRE(c.size() == 6);
+	REQUIRE(c[0].name == "quiet");
+	REQUIRE(c[0].result == verdict::FASTER);
+	REQUIRE(c[0].change == Approx(-0.1));
+	REQUIRE(c[0].noise == Approx(0.05));
+	REQUIRE(c[1].result == verdict::SLOWER);
+	REQUIRE(c[1].change == Approx(0.1));
+
+	// Under the threshold, however quiet the runs were
+	REQUIRE(c[2].result == verdict::SAME);
+
+	// Over the threshold, but well inside the noise: 3 * 1.4826 * hypot(0.2, 0.2) of the baseline
+	REQUIRE(c[3].result == verdict::SAME);
+	REQUIRE(c[3].change == Approx(0.1));
+	REQUIRE(c[3].noise == Approx(3 * 1.4826 * std::hypot(0.2, 0.2)));
+
+	REQUIRE(c[4].name == "gone");
+	REQUIRE(c[4].result == verdict::REMOVED);
+	REQUIRE(c[5].name == "new");
+	REQUIRE(c[5].result == verdict::ADDED);
+	REQUIRE(c[5].current == 2.0);
+
+	// A lower threshold catches the small change, and fewer sigmas the noisy one
+	auto opts = compare_options{};
+	opts.threshold = 0.01;
+	opts.sigmas = 0.1;
+	const auto strict{compare_results(baseline, current, opts)};
+	REQUIRE(strict[2].result == verdict::SLOWER);
+	REQUIRE(strict[3].result == verdict::SLOWER);
+
+	// The same benchmark at another size is a different benchmark
+	auto resized{current};
+	resized[0].size = 200;
+	const auto moved{compare_results(baseline, resized)};
+	REQUIRE(moved[0].result == verdict::REMOVED);
+	REQUIRE(moved.back().result == verdict::ADDED);
+}
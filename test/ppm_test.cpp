@@ -1,6 +1,56 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 #include "ppm_file.h"
+#include "counting_resource.h"
+#include "draw.h"
+#include "resize.h"
+#include "blur.h"
+#include "image_stats.h"
+#include "mapped_file.h"
+#include "mapped_ppm.h"
+#include "transform.h"
+#include "lut.h"
+#include "quantise.h"
+#include "image_compare.h"
+#include "png.h"
+#include "qoi.h"
+#include "rle_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <zlib.h>
+
+/*!
+ * @brief A 64x48 image with each channel changing a different way across and down it
+ */
+static ppm_image noise_image(){
+	ppm_image noise{image_size(64, 48), rgb_pixel(0, 0, 0)};
+	for( int y = 0; y < 48; y++ ) {
+		for( int x = 0; x < 64; x++ ) {
+			noise[y][x] = rgb_pixel(static_cast<uint8_t>(x * 7 + y), static_cast<uint8_t>(x * y), static_cast<uint8_t>(y * 5));
+		}
+	}
+	return noise;
+}
+
+/*!
+ * @brief Check that however many bands an operation is split into, the result is the same
+ * @param make Gives the image the operation makes when run with a number of threads
+ */
+template<typename F>
+static void require_same_for_threads(const F &make){
+	const auto one{make(1u)};
+	for( const unsigned threads: {2u, 4u, 16u} ) {
+		const auto many{make(threads)};
+		REQUIRE(many.size() == one.size());
+		for( int y = 0; y < one.size().height(); y++ ) {
+			REQUIRE(many[y] == one[y]);
+		}
+	}
+}
 
 TEST_CASE("Pixels", "[pixels]"){
 	auto r { rgb_pixel::get_colour(rgb_pixel::colours::RED)};
@@ -101,6 +151,12 @@ TEST_CASE("PPM Building", "[ppm_build]"){
 
 	ppm.append_last_line(r);
 	REQUIRE(ppm[ppm.size().height()-1 ].back() == r);
+
+	ppm_image filled{image_size(4, 3), rgb_pixel(1, 2, 3)};
+	REQUIRE(filled.size() == image_size(4, 3));
+	REQUIRE(filled.max_colour() == 3);
+	REQUIRE(filled[2].size() == 4);
+	REQUIRE(filled[2][3] == rgb_pixel(1, 2, 3));
 }
 
 TEST_CASE("PPM Streaming", "[ppm_stream]"){
@@ -121,3 +177,909 @@ TEST_CASE("PPM Streaming", "[ppm_stream]"){
 	REQUIRE(EXPECTED_IMAGE == result.str());
 
 }
+
+TEST_CASE("PPM Binary", "[ppm_binary]"){
+	ppm_image ppm;
+	ppm << std::vector<rgb_pixel>{rgb_pixel(1, 2, 3), rgb_pixel(4, 5, 6)};
+	ppm << std::vector<rgb_pixel>{rgb_pixel(7, 8, 9)};
+
+	std::stringstream result;
+	ppm.write(result, ppm_image::format::P6);
+
+	// The short row is padded out with white
+	std::string EXPECTED_IMAGE { "P6\n2 2\n9\n\x01\x02\x03\x04\x05\x06\x07\x08\x09\xff\xff\xff"};
+	REQUIRE(EXPECTED_IMAGE == result.str());
+}
+
+TEST_CASE("Allocation counting", "[allocations]"){
+	counting_resource counter;
+	{
+		ppm_image ppm{0, &counter};
+		REQUIRE(ppm.resource() == &counter);
+		ppm << std::vector<rgb_pixel>(10, rgb_pixel(1, 1, 1));
+		ppm << std::vector<rgb_pixel>(10, rgb_pixel(2, 2, 2));
+		REQUIRE(counter.allocations() > 0);
+		REQUIRE(counter.in_use() >= 20 * sizeof(rgb_pixel));
+	}
+	REQUIRE(counter.in_use() == 0);
+	REQUIRE(counter.high_water() >= 20 * sizeof(rgb_pixel));
+
+	counter.reset();
+	REQUIRE(counter.allocations() == 0);
+	REQUIRE(counter.high_water() == 0);
+	{
+		// One allocation for the pixels and one for the line lengths
+		ppm_image filled{image_size(100, 50), rgb_pixel(), &counter};
+		REQUIRE(filled.resource() == &counter);
+		REQUIRE(counter.allocations() == 2);
+		REQUIRE(counter.bytes() >= 100 * 50 * sizeof(rgb_pixel));
+	}
+	REQUIRE(counter.in_use() == 0);
+}
+
+TEST_CASE("Views", "[view]"){
+	ppm_image ppm{image_size(4, 3), rgb_pixel(0, 0, 0)};
+	for( int y = 0; y < 3; y++ ) {
+		for( int x = 0; x < 4; x++ ) {
+			ppm[y][x] = rgb_pixel(static_cast<uint8_t>(x), static_cast<uint8_t>(y), 0);
+		}
+	}
+
+	const auto whole{ppm.view()};
+	REQUIRE(whole.size() == image_size(4, 3));
+	REQUIRE(whole.contiguous());
+	REQUIRE(whole[2][3] == rgb_pixel(3, 2, 0));
+
+	// Cropping shares the pixels, so writes through the crop show in the image
+	const auto middle{whole.crop({1, 1, 2, 2})};
+	REQUIRE(middle.size() == image_size(2, 2));
+	REQUIRE(middle.stride() == 4);
+	REQUIRE(!middle.contiguous());
+	REQUIRE(middle[0][0] == rgb_pixel(1, 1, 0));
+	REQUIRE(middle[1][1] == rgb_pixel(2, 2, 0));
+	middle[1][0] = rgb_pixel(9, 9, 9);
+	REQUIRE(ppm[2][1] == rgb_pixel(9, 9, 9));
+	REQUIRE(middle.crop({1, 0, 5, 5})[1][0] == rgb_pixel(2, 2, 0));
+
+	// Crops are clipped to the view
+	REQUIRE(whole.crop({3, 2, 10, 10}).size() == image_size(1, 1));
+	REQUIRE(whole.crop({-2, -2, 3, 3}).size() == image_size(1, 1));
+	REQUIRE(whole.crop({5, 0, 1, 1}).empty());
+
+	std::stringstream result;
+	write_view(result, middle.crop({0, 0, 2, 1}), ppm_image::format::P3);
+	REQUIRE(result.str() == "P3\n2 1\n255\n1 1 0 2 1 0 \n");
+
+	// Short lines are seen through a view padded with white
+	ppm_image built;
+	built << std::vector<rgb_pixel>{rgb_pixel(1, 2, 3), rgb_pixel(4, 5, 6)};
+	built.new_line();
+	built.append_last_line(rgb_pixel(7, 8, 9));
+	const auto &const_built = built;
+	REQUIRE(const_built[1].size() == 1);
+	REQUIRE(const_built.view()[1][0] == rgb_pixel(7, 8, 9));
+	REQUIRE(const_built.view()[1][1] == rgb_pixel::get_colour(rgb_pixel::colours::WHITE));
+}
+
+TEST_CASE("Drawing", "[draw]"){
+	const auto w{rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+	const rgb_pixel c{10, 20, 30};
+	ppm_image ppm{image_size(50, 40), w};
+
+	// Clipped to the image, and the colour isn't grey so it can't be set a byte at a time
+	fill_rect(ppm.view(), {45, 35, 10, 10}, c);
+	REQUIRE(ppm[34][45] == w);
+	REQUIRE(ppm[35][44] == w);
+	REQUIRE(ppm[35][45] == c);
+	REQUIRE(ppm[39][49] == c);
+	fill_rect(ppm.view(), {-5, -5, 7, 6}, rgb_pixel(0, 0, 0));
+	REQUIRE(ppm[0][0] == rgb_pixel(0, 0, 0));
+	REQUIRE(ppm[0][1] == rgb_pixel(0, 0, 0));
+	REQUIRE(ppm[0][2] == w);
+	REQUIRE(ppm[1][0] == w);
+	fill_rect(ppm.view(), {60, 0, 10, 10}, c);
+
+	// Long enough rows to take the copying path
+	fill(ppm.view().crop({5, 5, 40, 3}), c);
+	REQUIRE(ppm[5][5] == c);
+	REQUIRE(ppm[7][44] == c);
+	REQUIRE(ppm[7][45] == w);
+	REQUIRE(ppm[8][5] == w);
+
+	ppm_image src{image_size(3, 2), rgb_pixel(1, 1, 1)};
+	src[1][2] = rgb_pixel(2, 2, 2);
+	blit(src.view(), ppm.view(), 48, 20);
+	REQUIRE(ppm[20][48] == rgb_pixel(1, 1, 1));
+	REQUIRE(ppm[21][49] == rgb_pixel(1, 1, 1));
+	blit(src.view(), ppm.view(), -2, -1);
+	REQUIRE(ppm[0][0] == rgb_pixel(2, 2, 2));
+	REQUIRE(ppm[0][1] == rgb_pixel(0, 0, 0));
+	REQUIRE(ppm[1][0] == w);
+	blit(src.view(), ppm.view(), 0, 40);
+
+	// Spreading rows out in place, as an image that grows does
+	ppm_image grid{image_size(4, 4), w};
+	for( int i = 0; i < 9; i++ ) {
+		grid.view().data()[i] = rgb_pixel(static_cast<uint8_t>(i), 0, 0);
+	}
+	blit(image_view{grid.view().data(), image_size(3, 3), 3}, grid.view(), 0, 0);
+	for( int y = 0; y < 3; y++ ) {
+		for( int x = 0; x < 3; x++ ) {
+			REQUIRE(grid[y][x] == rgb_pixel(static_cast<uint8_t>(y * 3 + x), 0, 0));
+		}
+	}
+
+	// And back together again
+	blit(image_view{grid.view().data(), image_size(3, 3), 4}, mutable_image_view{grid.view().data(), image_size(3, 3), 3}, 0, 0);
+	for( int i = 0; i < 9; i++ ) {
+		REQUIRE(grid.view().data()[i] == rgb_pixel(static_cast<uint8_t>(i), 0, 0));
+	}
+}
+
+TEST_CASE("Resizing", "[resize]"){
+	const rgb_pixel a{0, 100, 200};
+	const rgb_pixel b{200, 100, 0};
+
+	// Nearest repeats pixels when growing
+	ppm_image small{image_size(2, 2), a};
+	small[1][1] = b;
+	const auto big{resize(small, image_size(4, 4), resize_filter::NEAREST)};
+	REQUIRE(big.size() == image_size(4, 4));
+	REQUIRE(big[0][0] == a);
+	REQUIRE(big[3][2] == b);
+	REQUIRE(big[2][3] == b);
+	REQUIRE(big[1][2] == a);
+
+	// Box averages the pixels covered, partly covered ones count for less
+	ppm_image stripes{image_size(4, 4), a};
+	for( int y = 0; y < 4; y++ ) {
+		stripes[y][1] = b;
+		stripes[y][3] = b;
+	}
+	const auto halved{resize(stripes, image_size(2, 2), resize_filter::BOX)};
+	REQUIRE(halved[0][0] == rgb_pixel(100, 100, 100));
+	REQUIRE(halved[1][1] == rgb_pixel(100, 100, 100));
+	const auto thirds{resize(stripes, image_size(3, 1), resize_filter::BOX)};
+	// The first of three covers a whole a and a third of a b
+	REQUIRE(thirds[0][0] == rgb_pixel(50, 100, 150));
+
+	// Bilinear blends between the pixels either side of each centre
+	ppm_image pair{image_size(2, 1), a};
+	pair[0][1] = b;
+	const auto blended{resize(pair, image_size(4, 1), resize_filter::BILINEAR)};
+	REQUIRE(blended[0][0] == a);
+	REQUIRE(blended[0][1] == rgb_pixel(50, 100, 150));
+	REQUIRE(blended[0][2] == rgb_pixel(150, 100, 50));
+	REQUIRE(blended[0][3] == b);
+
+	// A flat colour stays exactly the same whatever the sizes, the weights add up to exactly one
+	ppm_image flat{image_size(97, 61), rgb_pixel(255, 1, 254)};
+	flat.max_colour() = 255;
+	for( const auto filter: {resize_filter::NEAREST, resize_filter::BOX, resize_filter::BILINEAR} ) {
+		for( const auto size: {image_size(13, 7), image_size(200, 150), image_size(1, 1)} ) {
+			const auto out{resize(flat, size, filter)};
+			REQUIRE(out.max_colour() == 255);
+			for( int y = 0; y < size.height(); y++ ) {
+				for( int x = 0; x < size.width(); x++ ) {
+					REQUIRE(out[y][x] == rgb_pixel(255, 1, 254));
+				}
+			}
+		}
+	}
+
+	// Even shrinking a long way, far past what the fixed point weights can hold
+	for( const auto filter: {resize_filter::BOX, resize_filter::BILINEAR} ) {
+		for( const auto size: {image_size(100000, 1), image_size(1, 100000)} ) {
+			const ppm_image line{size, rgb_pixel(255, 1, 254)};
+			REQUIRE(resize(line, image_size(1, 1), filter)[0][0] == rgb_pixel(255, 1, 254));
+		}
+	}
+	ppm_image long_stripes{image_size(100000, 2), a};
+	for( int x = 1; x < 100000; x += 2 ) {
+		long_stripes[0][x] = b;
+		long_stripes[1][x] = b;
+	}
+	REQUIRE(resize(long_stripes, image_size(1, 1), resize_filter::BOX)[0][0] == rgb_pixel(100, 100, 100));
+	REQUIRE(resize(long_stripes, image_size(3, 1), resize_filter::BOX)[0][1] == rgb_pixel(100, 100, 100));
+
+	// However many bands it's split into the result is the same
+	const auto noise{noise_image()};
+	for( const auto filter: {resize_filter::NEAREST, resize_filter::BOX, resize_filter::BILINEAR} ) {
+		require_same_for_threads([&](const unsigned threads) { return resize(noise, image_size(21, 17), filter, threads); });
+	}
+
+	// Into part of another image
+	ppm_image canvas{image_size(10, 10), b};
+	resize(small.view(), canvas.view().crop({2, 2, 4, 4}), resize_filter::NEAREST);
+	REQUIRE(canvas[1][1] == b);
+	REQUIRE(canvas[2][2] == a);
+	REQUIRE(canvas[5][5] == b);
+	REQUIRE(canvas[6][6] == b);
+	REQUIRE(canvas[2][5] == a);
+	REQUIRE(canvas[5][6] == b);
+}
+
+TEST_CASE("Blurring", "[blur]"){
+	// The weights add up to exactly one, so a flat colour stays the same
+	// Even kernels so wide that each weight is only a unit or two, none goes negative and they stay symmetric
+	for( const auto &k: {gaussian_kernel(0.5), gaussian_kernel(2.0), box_kernel(3), box_kernel(5000), gaussian_kernel(1000.0)} ) {
+		int sum = 0;
+		for( const auto w: k.weights ) { sum += w; }
+		REQUIRE(sum == 1 << blur_kernel::bits);
+		REQUIRE(k.weights.size() == static_cast<size_t>(2 * k.radius + 1));
+		REQUIRE(*std::min_element(k.weights.begin(), k.weights.end()) >= 0);
+		REQUIRE(std::equal(k.weights.begin(), k.weights.end(), k.weights.rbegin()));
+
+		ppm_image flat{image_size(23, 19), rgb_pixel(255, 1, 254)};
+		convolve(flat.view(), k, 3);
+		for( int y = 0; y < 19; y++ ) {
+			for( int x = 0; x < 23; x++ ) {
+				REQUIRE(flat[y][x] == rgb_pixel(255, 1, 254));
+			}
+		}
+	}
+	REQUIRE(gaussian_kernel(2.0).radius == 6);
+	const auto wide{box_kernel(5000)};
+	REQUIRE(*std::max_element(wide.weights.begin(), wide.weights.end()) == 2);
+	REQUIRE_THROWS_AS(box_kernel(8192), std::runtime_error);
+
+	// A box of radius one spreads a dot into a 3x3 square of ninths
+	ppm_image dot{image_size(5, 5), rgb_pixel(0, 0, 0)};
+	dot[2][2] = rgb_pixel(0, 90, 180);
+	convolve(dot.view(), box_kernel(1));
+	REQUIRE(dot[1][1] == rgb_pixel(0, 10, 20));
+	REQUIRE(dot[2][2] == rgb_pixel(0, 10, 20));
+	REQUIRE(dot[3][2] == rgb_pixel(0, 10, 20));
+	REQUIRE(dot[0][2] == rgb_pixel(0, 0, 0));
+	REQUIRE(dot[2][4] == rgb_pixel(0, 0, 0));
+
+	// A Gaussian spreads it the same way in every direction
+	ppm_image spot{image_size(15, 15), rgb_pixel(0, 0, 0)};
+	spot[7][7] = rgb_pixel(255, 255, 255);
+	convolve(spot.view(), gaussian_kernel(1.5));
+	REQUIRE(spot[7][7].red() > spot[7][8].red());
+	REQUIRE(spot[7][8].red() > spot[7][9].red());
+	REQUIRE(spot[7][5] == spot[7][9]);
+	REQUIRE(spot[5][7] == spot[7][9]);
+	REQUIRE(spot[9][7] == spot[7][5]);
+
+	// However many bands it's split into the result is the same, even bands narrower than the radius
+	const auto noise{noise_image()};
+	require_same_for_threads([&](const unsigned threads) {
+		auto blurred{noise};
+		convolve(blurred.view(), gaussian_kernel(2.0), threads);
+		return blurred;
+	});
+
+	// Only part of an image, the edges of the crop are repeated rather than reading past them
+	ppm_image canvas{image_size(10, 10), rgb_pixel(200, 200, 200)};
+	fill_rect(canvas.view(), {2, 2, 4, 4}, rgb_pixel(0, 0, 0));
+	canvas[3][3] = rgb_pixel(90, 90, 90);
+	convolve(canvas.view().crop({2, 2, 4, 4}), box_kernel(1));
+	REQUIRE(canvas[1][1] == rgb_pixel(200, 200, 200));
+	REQUIRE(canvas[6][6] == rgb_pixel(200, 200, 200));
+	REQUIRE(canvas[2][2] == rgb_pixel(10, 10, 10));
+	REQUIRE(canvas[5][5] == rgb_pixel(0, 0, 0));
+}
+
+TEST_CASE("Statistics", "[stats]"){
+	const rgb_pixel white{255, 255, 255};
+	ppm_image image{image_size(7, 5), white};
+	fill_rect(image.view(), {1, 1, 3, 2}, rgb_pixel(10, 20, 30));
+	image[4][6] = rgb_pixel(0, 200, 100);
+
+	const auto stats{measure(image.view(), white)};
+	REQUIRE(stats.pixels == 35);
+	REQUIRE(stats.foreground == 7);
+	REQUIRE(stats.histogram[0][10] == 6);
+	REQUIRE(stats.histogram[0][0] == 1);
+	REQUIRE(stats.histogram[1][200] == 1);
+	REQUIRE(stats.histogram[2][255] == 28);
+	REQUIRE(stats.min == rgb_pixel(0, 20, 30));
+	REQUIRE(stats.max == rgb_pixel(255, 255, 255));
+	REQUIRE(stats.mean[0] == Approx((28 * 255 + 6 * 10) / 35.0));
+
+	// However many bands it's split into, or however it's cropped, the counts add up the same
+	for( const unsigned threads: {2u, 3u, 8u} ) {
+		const auto split{measure(image.view(), white, threads)};
+		REQUIRE(split.histogram == stats.histogram);
+		REQUIRE(split.foreground == stats.foreground);
+	}
+	const auto part{measure(image.view().crop({1, 1, 3, 2}), white)};
+	REQUIRE(part.pixels == 6);
+	REQUIRE(part.foreground == 6);
+	REQUIRE(part.min == rgb_pixel(10, 20, 30));
+	REQUIRE(part.max == rgb_pixel(10, 20, 30));
+
+	std::stringstream json;
+	stats.write_json(json);
+	REQUIRE(json.str().find("\"foreground\": 7") != std::string::npos);
+	REQUIRE(json.str().find("\"min\": [0, 20, 30]") != std::string::npos);
+}
+
+TEST_CASE("Mapped files", "[mapped]"){
+	const auto dir{std::filesystem::temp_directory_path() / "songsim_mapped_test"};
+	std::filesystem::create_directories(dir);
+	const auto path{(dir / "image.ppm").string()};
+
+	ppm_image image{image_size(9, 4), rgb_pixel(1, 2, 3)};
+	image[2][5] = rgb_pixel(250, 0, 7);
+	image.max_colour() = 250;
+	{
+		std::ofstream file{path, std::ios::binary};
+		image.write(file, ppm_image::format::P6);
+	}
+
+	{
+		const mapped_ppm mapped{path};
+		REQUIRE(mapped.size() == image_size(9, 4));
+		REQUIRE(mapped.max_colour() == 250);
+		for( int y = 0; y < 4; y++ ) {
+			REQUIRE(mapped.view()[y] == image[y]);
+		}
+		const auto stats{measure(mapped.view(), rgb_pixel(1, 2, 3), 2)};
+		REQUIRE(stats.foreground == 1);
+		REQUIRE(stats.histogram == measure(image.view(), rgb_pixel(1, 2, 3)).histogram);
+	}
+
+	// Comments are allowed between the numbers of the header
+	{
+		std::ofstream file{path, std::ios::binary};
+		file << "P6\n# a comment\n2 1\n255\n" << "abcdef";
+	}
+	const mapped_ppm commented{path};
+	REQUIRE(commented.view()[0][1] == rgb_pixel('d', 'e', 'f'));
+
+	const auto bad = [&](const std::string &contents) {
+		std::ofstream file{path, std::ios::binary};
+		file << contents;
+	};
+	bad("P3\n1 1\n255\n1 2 3\n");
+	REQUIRE_THROWS_AS(mapped_ppm{path}, std::runtime_error);
+	bad("P6\n2 2\n255\nabc");
+	REQUIRE_THROWS_AS(mapped_ppm{path}, std::runtime_error);
+	bad("P6\n1 1\n65535\nabcdef");
+	REQUIRE_THROWS_AS(mapped_ppm{path}, std::runtime_error);
+	bad("");
+	REQUIRE_THROWS_AS(mapped_ppm{path}, std::runtime_error);
+	REQUIRE_THROWS_AS(mapped_ppm{(dir / "missing.ppm").string()}, std::runtime_error);
+
+	// Mapped to write, the file's made or resized and what's written ends up in it
+	const auto raw{(dir / "raw.bin").string()};
+	{
+		mapped_file written{raw, 4};
+		std::memcpy(written.data(), "abcd", 4);
+		auto moved{std::move(written)};
+		REQUIRE(written.data() == nullptr);
+		moved = mapped_file{raw, 6};
+		moved.data()[5] = 'f';
+	}
+	const mapped_file reread{raw};
+	REQUIRE(reread.size() == 6);
+	REQUIRE(std::memcmp(reread.data(), "abcd", 4) == 0);
+	REQUIRE(reread.data()[5] == 'f');
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Transforms", "[transform]"){
+	// Big enough for several tiles, and not a multiple of them
+	const int w = 70, h = 45;
+	ppm_image image{image_size(w, h), rgb_pixel(0, 0, 0)};
+	for( int y = 0; y < h; y++ ) {
+		for( int x = 0; x < w; x++ ) {
+			image[y][x] = rgb_pixel(static_cast<uint8_t>(x), static_cast<uint8_t>(y), static_cast<uint8_t>(x ^ y));
+		}
+	}
+	image.max_colour() = 200;
+
+	ppm_image swapped{image_size(h, w), rgb_pixel(0, 0, 0)};
+	transpose(image.view(), swapped.view(), 3);
+	const auto cw{rotate(image, rotation::CW_90, 2)};
+	const auto half{rotate(image, rotation::CW_180, 2)};
+	const auto ccw{rotate(image, rotation::CW_270)};
+	REQUIRE(cw.size() == image_size(h, w));
+	REQUIRE(half.size() == image_size(w, h));
+	REQUIRE(cw.max_colour() == 200);
+	for( int y = 0; y < h; y++ ) {
+		for( int x = 0; x < w; x++ ) {
+			REQUIRE(swapped[x][y] == image[y][x]);
+			REQUIRE(cw[x][h - 1 - y] == image[y][x]);
+			REQUIRE(half[h - 1 - y][w - 1 - x] == image[y][x]);
+			REQUIRE(ccw[w - 1 - x][y] == image[y][x]);
+		}
+	}
+	REQUIRE_THROWS_AS(transpose(image.view(), image.view(), 1), std::runtime_error);
+
+	// Four quarter turns, or two flips and a half turn, get back where they started
+	auto turned{rotate(rotate(rotate(cw, rotation::CW_90), rotation::CW_90), rotation::CW_90)};
+	for( int y = 0; y < h; y++ ) {
+		REQUIRE(turned[y] == image[y]);
+	}
+	flip_horizontal(turned.view());
+	REQUIRE(turned[3][w - 1] == image[3][0]);
+	flip_vertical(turned.view());
+	REQUIRE(turned[h - 1][w - 1] == image[0][0]);
+	rotate(turned.view(), rotation::CW_180);
+	for( int y = 0; y < h; y++ ) {
+		REQUIRE(turned[y] == image[y]);
+	}
+
+	// In place on a square, as the copying versions do it
+	auto square{resize(image, image_size(w, w), resize_filter::NEAREST)};
+	for( const auto r: {rotation::CW_90, rotation::CW_180, rotation::CW_270} ) {
+		auto in_place{square};
+		rotate(in_place.view(), r);
+		const auto copied{rotate(square, r)};
+		for( int y = 0; y < w; y++ ) {
+			REQUIRE(in_place[y] == copied[y]);
+		}
+	}
+	auto in_place{square};
+	transpose(in_place.view());
+	for( int y = 0; y < w; y++ ) {
+		for( int x = 0; x < w; x++ ) {
+			REQUIRE(in_place[x][y] == square[y][x]);
+		}
+	}
+	REQUIRE_THROWS_AS(rotate(image.view(), rotation::CW_90), std::runtime_error);
+
+	// A view in place, leaving the rest alone
+	const auto corner{square[14][14]};
+	const auto outside{square[9][9]};
+	rotate(square.view().crop({10, 10, 5, 5}), rotation::CW_180);
+	REQUIRE(square[10][10] == corner);
+	REQUIRE(square[9][9] == outside);
+}
+
+TEST_CASE("Lookup tables", "[lut]"){
+	REQUIRE(gamma_lut(1.0) == identity_lut());
+	REQUIRE(contrast_lut(1.0) == identity_lut());
+	REQUIRE(gamma_lut(2.0)[255] == 255);
+	REQUIRE(gamma_lut(2.0)[128] == 64);
+	REQUIRE(gamma_lut(0.5)[64] == 128);
+	REQUIRE(contrast_lut(2.0)[64] == 0);
+	REQUIRE(contrast_lut(2.0)[192] == 255);
+	REQUIRE(contrast_lut(0.0)[10] == 128);
+	REQUIRE(brightness_lut(10)[250] == 255);
+	REQUIRE(brightness_lut(-10)[5] == 0);
+	// Only up to the max colour value is changed
+	REQUIRE(brightness_lut(10, 100)[95] == 100);
+	REQUIRE(gamma_lut(2.0, 100)[50] == 25);
+	REQUIRE(combine(brightness_lut(10), brightness_lut(-20))[100] == 90);
+
+	// Wide enough for whole vectors and a tail, every value in every channel
+	const int w = 300, h = 7;
+	ppm_image image{image_size(w, h), rgb_pixel(0, 0, 0)};
+	for( int y = 0; y < h; y++ ) {
+		for( int x = 0; x < w; x++ ) {
+			image[y][x] = rgb_pixel(static_cast<uint8_t>(x + y), static_cast<uint8_t>(x * 3), static_cast<uint8_t>(255 - x));
+		}
+	}
+	channel_lut red{}, green{}, blue{};
+	for( int v = 0; v < 256; v++ ) {
+		red[v] = static_cast<uint8_t>(255 - v);
+		green[v] = static_cast<uint8_t>(v * 7 + 3);
+		blue[v] = static_cast<uint8_t>(v / 2);
+	}
+	for( const unsigned threads: {1u, 3u} ) {
+		auto looked_up{image};
+		apply_lut(looked_up.view(), red, green, blue, threads);
+		auto same{image};
+		apply_lut(same.view(), green, threads);
+		for( int y = 0; y < h; y++ ) {
+			for( int x = 0; x < w; x++ ) {
+				const auto &p = image[y][x];
+				REQUIRE(looked_up[y][x] == rgb_pixel(red[p.red()], green[p.green()], blue[p.blue()]));
+				REQUIRE(same[y][x] == rgb_pixel(green[p.red()], green[p.green()], green[p.blue()]));
+			}
+		}
+	}
+
+	// Part of an image, leaving the rest alone
+	apply_lut(image.view().crop({1, 1, 2, 2}), red);
+	REQUIRE(image[1][1] == rgb_pixel(253, 252, 1));
+	REQUIRE(image[0][0] == rgb_pixel(0, 0, 255));
+	REQUIRE(image[1][3] == rgb_pixel(4, 9, 252));
+}
+
+TEST_CASE("Quantising", "[quantise]"){
+	// An image with fewer colours than asked for gets exactly those colours back
+	const std::vector<rgb_pixel> colours{rgb_pixel(255, 255, 255), rgb_pixel(200, 0, 0), rgb_pixel(0, 120, 0),
+										 rgb_pixel(0, 0, 40)};
+	ppm_image blocks{image_size(40, 30), colours[0]};
+	fill_rect(blocks.view(), {0, 0, 20, 10}, colours[1]);
+	fill_rect(blocks.view(), {20, 10, 20, 10}, colours[2]);
+	fill_rect(blocks.view(), {5, 20, 10, 5}, colours[3]);
+	const auto palette{median_cut(blocks.view(), 16, 2)};
+	REQUIRE(palette.size() == 4);
+	for( const auto &c: colours ) {
+		REQUIRE(std::find(palette.begin(), palette.end(), c) != palette.end());
+	}
+	// Without any error to spread, Floyd-Steinberg gives them back exactly as well
+	for( const auto d: {dither::NONE, dither::FLOYD_STEINBERG} ) {
+		const auto indexed{quantise(blocks.view(), 16, d, 3)};
+		REQUIRE(indexed.size == blocks.size());
+		const auto back{indexed.to_ppm()};
+		for( int y = 0; y < 30; y++ ) {
+			REQUIRE(back[y] == blocks[y]);
+		}
+	}
+
+	// Fewer colours than there are, the palette is the means of groups of them
+	const auto two{median_cut(blocks.view(), 2)};
+	REQUIRE(two.size() == 2);
+	REQUIRE_THROWS_AS(median_cut(blocks.view(), 0), std::runtime_error);
+
+	// A grey between black and white comes out as a mix of the two, as light on average as it was
+	ppm_image grey{image_size(64, 64), rgb_pixel(64, 64, 64)};
+	const std::vector<rgb_pixel> black_white{rgb_pixel(0, 0, 0), rgb_pixel(255, 255, 255)};
+	REQUIRE(quantise(grey.view(), black_white, dither::NONE).to_ppm()[5][5] == black_white[0]);
+	for( const auto d: {dither::ORDERED, dither::FLOYD_STEINBERG} ) {
+		const auto mixed{quantise(grey.view(), black_white, d)};
+		std::size_t whites = 0;
+		for( const auto i: mixed.indices ) { whites += i; }
+		const auto mean = 255.0 * whites / mixed.indices.size();
+		REQUIRE(mean > 40);
+		REQUIRE(mean < 90);
+	}
+
+	// Ordered dithering is the same however many bands it's split into
+	ppm_image gradient{image_size(100, 37), rgb_pixel(0, 0, 0)};
+	for( int y = 0; y < 37; y++ ) {
+		for( int x = 0; x < 100; x++ ) {
+			gradient[y][x] = rgb_pixel(static_cast<uint8_t>(x * 2), static_cast<uint8_t>(y * 6), 100);
+		}
+	}
+	const auto one{quantise(gradient.view(), 8, dither::ORDERED, 1)};
+	const auto four{quantise(gradient.view(), 8, dither::ORDERED, 4)};
+	REQUIRE(one.palette.size() == 8);
+	REQUIRE(one.palette == four.palette);
+	REQUIRE(one.indices == four.indices);
+}
+
+TEST_CASE("Comparing", "[compare]"){
+	ppm_image a{image_size(50, 20), rgb_pixel(100, 100, 100)};
+	auto b{a};
+	REQUIRE(images_equal(a.view(), b.view()));
+	const auto same{compare_images(a.view(), b.view(), 3)};
+	REQUIRE(same.same());
+	REQUIRE(same.pixels == 1000);
+	REQUIRE(same.max_delta == 0);
+	REQUIRE(std::isinf(same.psnr));
+
+	b[7][30] = rgb_pixel(110, 100, 90);
+	b[19][49] = rgb_pixel(100, 101, 100);
+	REQUIRE_FALSE(images_equal(a.view(), b.view()));
+	ppm_image diff{image_size(50, 20), rgb_pixel(1, 1, 1)};
+	const auto differ{compare_images(a.view(), b.view(), diff.view(), 2)};
+	REQUIRE_FALSE(differ.same());
+	REQUIRE(differ.differing == 2);
+	REQUIRE(differ.max_delta == 10);
+	REQUIRE(differ.mse == Approx(201.0 / 3000));
+	REQUIRE(differ.psnr == Approx(10 * std::log10(255.0 * 255 * 3000 / 201)));
+	REQUIRE(diff[7][30] == rgb_pixel(10, 0, 10));
+	REQUIRE(diff[19][49] == rgb_pixel(0, 1, 0));
+	REQUIRE(diff[0][0] == rgb_pixel(0, 0, 0));
+	REQUIRE(diff[7][29] == rgb_pixel(0, 0, 0));
+
+	// However many bands it's split into
+	REQUIRE(compare_images(a.view(), b.view(), 1).differing == 2);
+	REQUIRE(compare_images(a.view(), b.view(), 7).mse == differ.mse);
+
+	// Views of parts of images, and different sizes
+	REQUIRE(images_equal(a.view().crop({0, 0, 10, 10}), b.view().crop({0, 0, 10, 10})));
+	REQUIRE_FALSE(images_equal(a.view(), a.view().crop({0, 0, 10, 10})));
+	REQUIRE_THROWS_AS(compare_images(a.view(), a.view().crop({0, 0, 10, 10})), std::runtime_error);
+
+	// Against a file on disk, without reading it in
+	const auto dir{std::filesystem::temp_directory_path() / "songsim_compare_test"};
+	std::filesystem::create_directories(dir);
+	const auto path{(dir / "b.ppm").string()};
+	{
+		std::ofstream file{path, std::ios::binary};
+		b.write(file, ppm_image::format::P6);
+	}
+	{
+		const mapped_ppm mapped{path};
+		REQUIRE(images_equal(mapped.view(), b.view()));
+		REQUIRE(compare_images(a.view(), mapped.view()).differing == 2);
+	}
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Hashing", "[hash]"){
+	// The published XXH64 test vectors
+	REQUIRE(xxh64_hash("", 0) == 0xef46db3751d8e999ULL);
+	REQUIRE(xxh64_hash("a", 1) == 0xd24ec4f1a98c6e5bULL);
+	REQUIRE(xxh64_hash("abc", 3) == 0x44bc2cf5ad770999ULL);
+	const std::string spam{"Nobody inspects the spammish repetition"};
+	REQUIRE(xxh64_hash(spam.data(), spam.size()) == 0xfbcea83c8a378bf1ULL);
+	REQUIRE(hash_hex(0xfbcea83c8a378bf1ULL) == "fbcea83c8a378bf1");
+	REQUIRE(hash_hex(1) == "0000000000000001");
+
+	// However it's split up
+	std::string long_text;
+	for( int i = 0; i < 100; i++ ) { long_text += spam; }
+	const auto whole{xxh64_hash(long_text.data(), long_text.size(), 7)};
+	for( const std::size_t piece: {1, 5, 31, 32, 33, 1000} ) {
+		xxh64 h{7};
+		for( std::size_t i = 0; i < long_text.size(); i += piece ) {
+			h.update(long_text.data() + i, std::min(piece, long_text.size() - i));
+		}
+		REQUIRE(h.digest() == whole);
+	}
+
+	// Worked out while writing, the same in either format, and for a view of the image
+	ppm_image image{image_size(20, 10), rgb_pixel(1, 2, 3)};
+	image[4][7] = rgb_pixel(9, 9, 9);
+	std::stringstream p3, p6;
+	const auto written{image.write(p3, ppm_image::format::P3)};
+	REQUIRE(written == image.write(p6, ppm_image::format::P6));
+	REQUIRE(written == image_hash(image.view()));
+	ppm_image canvas{image_size(30, 30), rgb_pixel(0, 0, 0)};
+	blit(image.view(), canvas.view(), 5, 5);
+	REQUIRE(image_hash(canvas.view().crop({5, 5, 20, 10})) == written);
+
+	// The same pixels in another shape, or one pixel different, hash differently
+	ppm_image same_pixels{image_size(10, 20), rgb_pixel(1, 2, 3)};
+	REQUIRE(image_hash(same_pixels.view()) != image_hash(ppm_image{image_size(20, 10), rgb_pixel(1, 2, 3)}.view()));
+	image[9][19] = rgb_pixel(1, 2, 4);
+	REQUIRE(image_hash(image.view()) != written);
+
+	// Short rows hash as the white they're written as
+	ppm_image ragged{UINT8_MAX};
+	ragged << std::vector<rgb_pixel>{rgb_pixel(5, 5, 5), rgb_pixel(6, 6, 6)};
+	ragged << std::vector<rgb_pixel>{rgb_pixel(7, 7, 7)};
+	ppm_image padded{image_size(2, 2), rgb_pixel(255, 255, 255)};
+	padded[0][0] = rgb_pixel(5, 5, 5);
+	padded[0][1] = rgb_pixel(6, 6, 6);
+	padded[1][0] = rgb_pixel(7, 7, 7);
+	std::stringstream out;
+	REQUIRE(ragged.write(out, ppm_image::format::P3) == image_hash(padded.view()));
+
+	// A comment goes after the magic number
+	std::stringstream commented;
+	padded.write(commented, ppm_image::format::P6, "made by a test\nsecond line");
+	REQUIRE(commented.str().rfind("P6\n# made by a test\n# second line\n2 2\n255\n", 0) == 0);
+}
+
+TEST_CASE("PNG", "[png]"){
+	// Read the chunks back, checking each one's CRC, and undo the filters
+	const auto read_png = [](const std::string& file, std::string& comment){
+		REQUIRE(file.compare(0, 8, "\x89PNG\r\n\x1a\n") == 0);
+		const auto u32 = [&](const std::size_t at){
+			std::uint32_t v{0};
+			for( std::size_t i = 0; i < 4; i++ ) { v = v << 8 | static_cast<std::uint8_t>(file[at + i]); }
+			return v;
+		};
+		std::string idat, last_type;
+		int width{0}, height{0};
+		for( std::size_t at = 8; at < file.size(); ) {
+			const auto length{u32(at)};
+			const auto type{file.substr(at + 4, 4)};
+			const auto data{file.substr(at + 8, length)};
+			REQUIRE(u32(at + 8 + length) == crc32(0, reinterpret_cast<const Bytef*>(file.data() + at + 4), length + 4));
+			if( type == "IHDR" ) {
+				width = static_cast<int>(u32(at + 8));
+				height = static_cast<int>(u32(at + 12));
+				REQUIRE(data.substr(8) == std::string{8, 2, 0, 0, 0});
+			}
+			if( type == "tEXt" ) { comment = data; }
+			if( type == "IDAT" ) { idat += data; }
+			last_type = type;
+			at += 12 + length;
+		}
+		REQUIRE(last_type == "IEND");
+
+		// Inflating checks the zlib header and the Adler-32 the strips were stitched with
+		const auto row_bytes{static_cast<std::size_t>(width) * 3 + 1};
+		std::vector<std::uint8_t> raw(row_bytes * height);
+		uLongf raw_size{static_cast<uLongf>(raw.size())};
+		REQUIRE(uncompress(raw.data(), &raw_size, reinterpret_cast<const Bytef*>(idat.data()), idat.size()) == Z_OK);
+		REQUIRE(raw_size == raw.size());
+
+		ppm_image image{image_size(width, height), rgb_pixel(0, 0, 0)};
+		std::vector<std::uint8_t> above(row_bytes - 1), row(row_bytes - 1);
+		for( int y = 0; y < height; y++ ) {
+			const auto* in{raw.data() + row_bytes * y};
+			REQUIRE(in[0] < 5);
+			for( std::size_t i = 0; i < row.size(); i++ ) {
+				const int a{i >= 3 ? row[i - 3] : 0}, b{above[i]}, c{i >= 3 ? above[i - 3] : 0};
+				const int p{a + b - c}, pa{std::abs(p - a)}, pb{std::abs(p - b)}, pc{std::abs(p - c)};
+				const int predictions[]{0, a, b, (a + b) / 2, pa <= pb && pa <= pc ? a : pb <= pc ? b : c};
+				row[i] = static_cast<std::uint8_t>(in[i + 1] + predictions[in[0]]);
+			}
+			std::memcpy(image[y].data(), row.data(), row.size());
+			above = row;
+		}
+		return image;
+	};
+
+	// Big enough for several strips, with smooth parts, noise and flat white for the filters to choose between
+	ppm_image image{image_size(600, 500), rgb_pixel(255, 255, 255)};
+	std::uint32_t seed{12345};
+	for( int y = 0; y < 500; y++ ) {
+		for( int x = 0; x < 200; x++ ) {
+			seed = seed * 1664525 + 1013904223;
+			image[y][x] = rgb_pixel(static_cast<uint8_t>(x + y), static_cast<uint8_t>(y), static_cast<uint8_t>(seed >> 24));
+		}
+	}
+
+	for( const unsigned threads: {1u, 4u} ) {
+		std::stringstream out;
+		REQUIRE(write_png(out, image.view(), threads) == image_hash(image.view()));
+		std::string comment;
+		REQUIRE(images_equal(read_png(out.str(), comment).view(), image.view()));
+		REQUIRE(comment.empty());
+		// Mostly white, so it should shrink a lot
+		REQUIRE(out.str().size() < 600 * 500 * 3 / 4);
+	}
+
+	// A view, uncompressed
+	std::stringstream stored;
+	const auto part{image.view().crop({150, 10, 100, 20})};
+	write_png(stored, part, 1, 0);
+	std::string comment;
+	REQUIRE(images_equal(read_png(stored.str(), comment).view(), part));
+
+	// Short rows are white, as in a PPM, and the comment is kept
+	std::stringstream ragged;
+	png_writer writer{ragged, image_size(3, 2), 1, 9, "songsim input 0123"};
+	const rgb_pixel first[]{rgb_pixel(1, 2, 3), rgb_pixel(4, 5, 6)};
+	writer.write_row(first, 2);
+	writer.write_row(first, 1);
+	REQUIRE_THROWS_AS(writer.write_row(first, 1), std::runtime_error);
+	ppm_image padded{image_size(3, 2), rgb_pixel(255, 255, 255)};
+	padded[0][0] = padded[1][0] = first[0];
+	padded[0][1] = first[1];
+	REQUIRE(writer.pixel_hash() == image_hash(padded.view()));
+	REQUIRE(images_equal(read_png(ragged.str(), comment).view(), padded.view()));
+	REQUIRE(comment == std::string{"Comment"} + '\0' + "songsim input 0123");
+
+	std::stringstream nothing;
+	REQUIRE_THROWS_AS(png_writer(nothing, image_size(0, 4)), std::runtime_error);
+	REQUIRE_THROWS_AS(png_writer(nothing, image_size(4, 4), 1, 10), std::runtime_error);
+}
+
+TEST_CASE("QOI", "[qoi]"){
+	// Worked out by hand from the spec: white is a small difference from the black it starts at, then a run
+	ppm_image tiny{image_size(3, 1), rgb_pixel(255, 255, 255)};
+	tiny[0][2] = rgb_pixel(0, 0, 0);
+	std::stringstream small;
+	REQUIRE(write_qoi(small, tiny.view()) == image_hash(tiny.view()));
+	REQUIRE(small.str() == std::string{"qoif\0\0\0\3\0\0\0\1\3\0\x55\xc0\x7f\0\0\0\0\0\0\0\1", 25});
+
+	// Runs longer than a byte holds and across rows, gradients, repeats and noise
+	ppm_image image{image_size(300, 200), rgb_pixel(255, 255, 255)};
+	std::uint32_t seed{99};
+	for( int y = 0; y < 200; y++ ) {
+		for( int x = 0; x < 100; x++ ) {
+			seed = seed * 1664525 + 1013904223;
+			image[y][x] = rgb_pixel(static_cast<uint8_t>(x + y), static_cast<uint8_t>(x * 2), static_cast<uint8_t>(y));
+			image[y][x + 100] = rgb_pixel::get_colour(static_cast<rgb_pixel::colours>(seed >> 29 & 3));
+			if( y % 3 ) { image[y][x + 200] = rgb_pixel(static_cast<uint8_t>(seed >> 8), static_cast<uint8_t>(seed >> 16), static_cast<uint8_t>(seed >> 24)); }
+		}
+	}
+	std::stringstream out;
+	REQUIRE(write_qoi(out, image.view()) == image_hash(image.view()));
+	const auto read{read_qoi(out)};
+	REQUIRE(images_equal(read.view(), image.view()));
+	REQUIRE(read.max_colour() == 255);
+
+	// Mostly white shrinks to almost nothing
+	ppm_image white{image_size(1000, 1000), rgb_pixel(255, 255, 255)};
+	white[500][500] = rgb_pixel(1, 2, 3);
+	std::stringstream sparse;
+	write_qoi(sparse, white.view());
+	REQUIRE(sparse.str().size() < 1000 * 1000 / 50);
+	REQUIRE(images_equal(read_qoi(sparse).view(), white.view()));
+
+	// A view, and short rows padded with white
+	const auto part{image.view().crop({50, 20, 120, 30})};
+	std::stringstream cropped;
+	write_qoi(cropped, part);
+	REQUIRE(images_equal(read_qoi(cropped).view(), part));
+	std::stringstream ragged;
+	qoi_writer writer{ragged, image_size(3, 2)};
+	const rgb_pixel dark[]{rgb_pixel(1, 2, 3), rgb_pixel(4, 5, 6)};
+	writer.write_row(dark, 2);
+	writer.write_row(dark, 1);
+	REQUIRE_THROWS_AS(writer.write_row(dark, 1), std::runtime_error);
+	ppm_image padded{image_size(3, 2), rgb_pixel(255, 255, 255)};
+	padded[0][0] = padded[1][0] = dark[0];
+	padded[0][1] = dark[1];
+	REQUIRE(writer.pixel_hash() == image_hash(padded.view()));
+	REQUIRE(images_equal(read_qoi(ragged).view(), padded.view()));
+
+	// Files from elsewhere can have alpha, which is dropped, and the max colour comes from the pixels
+	std::stringstream rgba{std::string{"qoif\0\0\0\2\0\0\0\1\4\0\xff\x10\x20\x30\x80\x55\0\0\0\0\0\0\0\1", 27}};
+	const auto dropped{read_qoi(rgba)};
+	REQUIRE(dropped[0][0] == rgb_pixel(0x10, 0x20, 0x30));
+	REQUIRE(dropped[0][1] == rgb_pixel(0x10 - 1, 0x20 - 1, 0x30 - 1));
+	REQUIRE(dropped.max_colour() == 0x30);
+
+	std::stringstream not_qoi{"P6\n1 1\n255\n..."};
+	REQUIRE_THROWS_AS(read_qoi(not_qoi), std::runtime_error);
+	std::stringstream cut{small.str().substr(0, 15)};
+	REQUIRE_THROWS_AS(read_qoi(cut), std::runtime_error);
+	std::stringstream huge{std::string{"qoif\xff\xff\xff\xff\xff\xff\xff\xff\3\0", 14}};
+	REQUIRE_THROWS_AS(read_qoi(huge), std::runtime_error);
+	std::stringstream nothing;
+	REQUIRE_THROWS_AS(qoi_writer(nothing, image_size(0, 0)), std::runtime_error);
+}
+
+TEST_CASE("Run lengths", "[rle]"){
+	const auto white{rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+	const auto red{rgb_pixel::get_colour(rgb_pixel::colours::RED)};
+	rle_image runs{image_size(10, 3), white};
+	REQUIRE(runs.run_count() == 3);
+	REQUIRE(runs.max_colour() == 255);
+
+	// Splitting from the middle, the ends, then joining back up
+	runs.set(5, 0, red);
+	REQUIRE(runs.runs(0).size() == 3);
+	runs.set(4, 0, red);
+	runs.set(6, 0, red);
+	REQUIRE(runs.runs(0).size() == 3);
+	REQUIRE(runs.runs(0)[1].end == 7);
+	runs.set(0, 0, red);
+	runs.set(9, 0, red);
+	REQUIRE(runs.runs(0).size() == 5);
+	runs.set(5, 0, white);
+	REQUIRE(runs.runs(0).size() == 7);
+	runs.set(5, 0, red);
+	REQUIRE(runs.runs(0).size() == 5);
+	runs.set(0, 0, white);
+	runs.set(9, 0, white);
+	REQUIRE(runs.runs(0).size() == 3);
+	REQUIRE(runs.at(3, 0) == white);
+	REQUIRE(runs.at(4, 0) == red);
+	REQUIRE(runs.at(6, 0) == red);
+	REQUIRE(runs.at(7, 0) == white);
+
+	// One pixel wide runs join both their neighbours
+	runs.set(1, 1, red);
+	runs.set(3, 1, red);
+	runs.set(2, 1, rgb_pixel(1, 2, 3));
+	REQUIRE(runs.runs(1).size() == 5);
+	runs.set(2, 1, red);
+	REQUIRE(runs.runs(1).size() == 3);
+	runs.set(2, 1, white);
+	runs.set(1, 1, white);
+	runs.set(3, 1, white);
+	REQUIRE(runs.runs(1).size() == 1);
+
+	// Random writes match the same writes to a ppm_image, and it's written out the same
+	rle_image big{image_size(200, 50), white};
+	ppm_image dense{image_size(200, 50), white};
+	std::uint32_t seed{5};
+	for( int i = 0; i < 5000; i++ ) {
+		seed = seed * 1664525 + 1013904223;
+		const auto x{static_cast<int>(seed >> 8) % 200}, y{static_cast<int>(seed >> 20) % 50};
+		const auto colour{rgb_pixel::get_colour(static_cast<rgb_pixel::colours>(seed >> 29 & 3))};
+		big.set(x, y, colour);
+		dense[y][x] = colour;
+	}
+	REQUIRE(images_equal(big.to_ppm().view(), dense.view()));
+	for( int y = 0; y < 50; y++ ) {
+		for( std::size_t r = 1; r < big.runs(y).size(); r++ ) {
+			REQUIRE(big.runs(y)[r].colour != big.runs(y)[r - 1].colour);
+		}
+	}
+	for( const auto f: {ppm_image::format::P3, ppm_image::format::P6} ) {
+		std::stringstream from_runs, from_pixels;
+		REQUIRE(big.write(from_runs, f) == dense.write(from_pixels, f));
+		REQUIRE(from_runs.str() == from_pixels.str());
+	}
+	std::stringstream png_runs, png_pixels;
+	png_writer writer{png_runs, big.size()};
+	REQUIRE(big.write_to(writer) == write_png(png_pixels, dense.view()));
+	REQUIRE(png_runs.str() == png_pixels.str());
+
+	// The max colour comes from the runs
+	rle_image dark{image_size(4, 4), rgb_pixel(0, 0, 0)};
+	dark.set(1, 1, rgb_pixel(3, 9, 2));
+	REQUIRE(dark.max_colour() == 9);
+	REQUIRE(dark.to_ppm().max_colour() == 9);
+}
@@ -0,0 +1,394 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "song_sim.h"
+#include "batch.h"
+#include "density.h"
+#include "planner.h"
+#include "png.h"
+#include "pyramid.h"
+#include "qoi.h"
+#include "session.h"
+#include "stats.h"
+#include "trace.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+/*!
+ * @brief Read back a P6 file written by ppm_image::write
+ */
+static ppm_image read_p6(const std::string &path){
+	std::ifstream in{path, std::ios::binary};
+	std::string magic;
+	int w, h, max;
+	in >> magic >> w >> h >> max;
+	in.get();
+	ppm_image p{image_size(w, h), rgb_pixel()};
+	for( int row = 0; row < h; row++ ) {
+		in.read(reinterpret_cast<char *>(p[row].data()), w * 3);
+	}
+	return p;
+}
+
+TEST_CASE("Reading", "[read]"){
+	std::stringstream in{"Paul, pat PAUL pat!\nrob"};
+	const auto s{read_song(in)};
+
+	REQUIRE(s.word_num == 5);
+	REQUIRE(s.wordmap.size() == 3);
+	REQUIRE(s.wordmap.at("paul") == std::vector<int>{0, 2});
+	REQUIRE(s.wordmap.at("pat") == std::vector<int>{1, 3});
+	REQUIRE(s.wordmap.at("rob") == std::vector<int>{4});
+	REQUIRE(s.max_occurrences == 2);
+	REQUIRE(render_bytes(s) >= 25 * sizeof(rgb_pixel));
+}
+
+TEST_CASE("Tokenising", "[tokenise]"){
+	std::string text{"  Don't\tSTOP,\n me now!! "};
+	const auto words{tokenise(text)};
+	REQUIRE(words == std::vector<std::string_view>{"dont", "stop", "me", "now"});
+
+	song s;
+	index_words(s, words);
+	index_words(s, {"stop"});
+	REQUIRE(s.word_num == 5);
+	REQUIRE(s.wordmap.at("stop") == std::vector<int>{1, 4});
+	REQUIRE(s.max_occurrences == 2);
+}
+
+TEST_CASE("Rendering", "[render]"){
+	std::stringstream in{"paul pat paul pat rob"};
+	const auto s{read_song(in)};
+	auto p{render_song(s)};
+	const auto w{rgb_pixel::get_colour(rgb_pixel::colours::WHITE)};
+
+	REQUIRE(p.size() == image_size(5, 5));
+	REQUIRE(p[0][0] == rgb_pixel(127, 127, 254));
+	REQUIRE(p[0][2] == rgb_pixel(127, 254, 254));
+	REQUIRE(p[2][0] == rgb_pixel(254, 127, 254));
+	REQUIRE(p[0][1] == w);
+	REQUIRE(p[4][4] == rgb_pixel(127, 127, 127));
+	REQUIRE(p[4][0] == w);
+
+	// However many bands it's split into the result is the same
+	for( unsigned threads = 2; threads < 8; threads++ ) {
+		auto banded{render_song(s, threads)};
+		for( int row = 0; row < 5; row++ ) {
+			REQUIRE(banded[row] == p[row]);
+		}
+	}
+
+	// As runs, which are the matching cells and the white between them
+	for( unsigned threads = 1; threads < 4; threads++ ) {
+		const auto runs{render_song_rle(s, threads)};
+		REQUIRE(runs.run_count() == 4 + 5 + 4 + 5 + 2);
+		REQUIRE(runs.at(2, 0) == p[0][2]);
+		const auto expanded{runs.to_ppm()};
+		for( int row = 0; row < 5; row++ ) {
+			REQUIRE(expanded[row] == p[row]);
+		}
+	}
+}
+
+TEST_CASE("Planning", "[plan]"){
+	std::stringstream in{"one two one three two one four one two five six two one seven"};
+	const auto s{read_song(in)};
+
+	auto dense{std::stringstream{}};
+	const auto hash{render_song(s).write(dense, ppm_image::format::P3)};
+
+	// With nothing to stop it, holding the whole image is fastest
+	auto plan{plan_render(s, 0)};
+	REQUIRE(plan.chosen == strategy::DENSE);
+	REQUIRE(plan.matches == 5 * 5 + 4 * 4 + 5);
+	REQUIRE(plan.estimates.size() == 4);
+	REQUIRE(plan.chosen_estimate().bytes == render_bytes(s));
+
+	// Squeezed, it picks whatever fits
+	plan = plan_render(s, 300);
+	REQUIRE(plan.chosen == strategy::SPARSE);
+	REQUIRE(plan.chosen_estimate().fits);
+	plan = plan_render(s, 100);
+	REQUIRE(plan.chosen == strategy::STREAMING);
+	REQUIRE(plan.chosen_estimate().bytes <= 100);
+	REQUIRE(plan.chunk_rows >= 1);
+	REQUIRE_THROWS_AS(plan_render(s, 10), std::runtime_error);
+
+	// Every strategy draws the same image
+	for( const auto kind: {strategy::DENSE, strategy::RLE, strategy::SPARSE, strategy::STREAMING} ) {
+		for( const auto limit: {std::uint64_t{0}, std::uint64_t{100}} ) {
+			for( unsigned threads = 1; threads < 4; threads++ ) {
+				auto out{std::stringstream{}};
+				REQUIRE(write_song(s, plan_render(s, limit, threads, kind), out, ppm_image::format::P3, threads) == hash);
+				REQUIRE(out.str() == dense.str());
+			}
+		}
+	}
+
+	// And the same PNG
+	auto dense_png{std::stringstream{}};
+	REQUIRE(write_png(dense_png, render_song(s).view()) == hash);
+	for( const auto kind: {strategy::DENSE, strategy::RLE, strategy::SPARSE, strategy::STREAMING} ) {
+		auto out{std::stringstream{}};
+		REQUIRE(write_song_png(s, plan_render(s, 100, 2, kind), out, 2) == hash);
+		REQUIRE(out.str() == dense_png.str());
+	}
+	auto empty{std::stringstream{}};
+	REQUIRE_THROWS_AS(write_song_png(read_song(empty), plan_render(s, 0), empty), std::runtime_error);
+
+	// And the same QOI image
+	auto dense_qoi{std::stringstream{}};
+	REQUIRE(write_qoi(dense_qoi, render_song(s).view()) == hash);
+	for( const auto kind: {strategy::DENSE, strategy::RLE, strategy::SPARSE, strategy::STREAMING} ) {
+		auto out{std::stringstream{}};
+		REQUIRE(write_song_qoi(s, plan_render(s, 100, 2, kind), out, 2) == hash);
+		REQUIRE(out.str() == dense_qoi.str());
+	}
+
+	strategy kind;
+	REQUIRE(!parse_strategy("bit-matrix", kind));
+	REQUIRE(parse_strategy("rle", kind));
+	REQUIRE(kind == strategy::RLE);
+	REQUIRE(!parse_strategy("lazy", kind));
+}
+
+TEST_CASE("Density", "[density]"){
+	std::stringstream in{"a b a c a b d a b c e a"};
+	const auto s{read_song(in)};
+	auto full{render_song(s)};
+
+	// Without any scaling down, max and mean are the full image
+	for( const auto mode : {aggregate::MAX, aggregate::MEAN} ) {
+		auto same{render_density(s, image_size(100, 100), mode)};
+		REQUIRE(same.size() == full.size());
+		for( int row = 0; row < s.word_num; row++ ) {
+			REQUIRE(same[row] == full[row]);
+		}
+	}
+
+	auto half{render_density(s, image_size(6, 3), aggregate::MEAN, 2)};
+	REQUIRE(half.size() == image_size(6, 3));
+	// The top left block is rows 0-3 and columns 0-1, of which (0,0) and (2,0) are "a" and (1,1) is "b"
+	REQUIRE(half[0][0] == rgb_pixel((51 + 102 + 51) / 3, (51 + 51 + 51) / 3, (255 + 255 + 153) / 3));
+
+	auto counted{render_density(s, image_size(1, 1), aggregate::COUNT)};
+	REQUIRE(counted.size() == image_size(1, 1));
+	REQUIRE(counted[0][0] != rgb_pixel::get_colour(rgb_pixel::colours::WHITE));
+
+	auto capped{render_density(s, image_size(3, 3), aggregate::MAX)};
+	REQUIRE(capped[0][0] == rgb_pixel(102, 102, 255));
+
+	// Max takes the bluest word in the block, whichever order the words are visited in
+	std::stringstream counts{"e d c b a d c b a c b a b a a"};
+	const auto mixed{read_song(counts)};
+	const auto k{255 / mixed.max_occurrences};
+	for( const auto size: {image_size(1, 1), image_size(2, 2)} ) {
+		REQUIRE(render_density(mixed, size, aggregate::MAX)[0][0].blue() == 5 * k);
+	}
+}
+
+TEST_CASE("Pyramid", "[pyramid]"){
+	// 64 words in 16 pixel tiles gives levels at a quarter, half and full size
+	std::stringstream in;
+	for( int i = 0; i < 64; i++ ) {
+		in << "w" << (i * 7) % 13 << " ";
+	}
+	const auto s{read_song(in)};
+	const auto dir{std::filesystem::temp_directory_path() / "songsim_pyramid_test"};
+	std::filesystem::remove_all(dir);
+
+	pyramid_options opts;
+	opts.out_dir = dir.string();
+	opts.tile_size = 16;
+	opts.threads = 3;
+	REQUIRE(write_pyramid(s, opts) == 1 + 2 * 2 + 4 * 4);
+	REQUIRE(std::filesystem::exists(dir / "manifest.json"));
+
+	auto full{render_song(s)};
+	auto tile{read_p6((dir / "2" / "1" / "3.ppm").string())};
+	REQUIRE(tile.size() == image_size(16, 16));
+	for( int row = 0; row < 16; row++ ) {
+		for( int col = 0; col < 16; col++ ) {
+			REQUIRE(tile[row][col] == full[16 + row][48 + col]);
+		}
+	}
+
+	auto top{read_p6((dir / "0" / "0" / "0.ppm").string())};
+	auto scaled{render_density(s, image_size(16, 16), aggregate::MEAN)};
+	for( int row = 0; row < 16; row++ ) {
+		REQUIRE(top[row] == scaled[row]);
+	}
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Batch", "[batch]"){
+	const auto dir{std::filesystem::temp_directory_path() / "songsim_batch_test"};
+	std::filesystem::remove_all(dir);
+	for( const auto *sub: {"a", "b", "c", "out"} ) { std::filesystem::create_directories(dir / sub); }
+
+	// Two songs with the same name, and one already called what the second would be renamed to
+	const std::vector<std::pair<std::string, std::string>> songs{
+		{"a/song.txt", "one two one"}, {"b/song.txt", "three four"}, {"c/song-2.txt", "five"}};
+	auto inputs = std::vector<std::string>{};
+	for( const auto &song: songs ) {
+		inputs.push_back((dir / song.first).string());
+		std::ofstream{inputs.back()} << song.second;
+	}
+
+	auto opts = batch_options{};
+	opts.out_dir = (dir / "out").string();
+	opts.jobs = 2;
+	const auto results{run_batch(inputs, opts)};
+	REQUIRE(results.size() == 3);
+	REQUIRE(results[0].output == (dir / "out" / "song.ppm").string());
+	REQUIRE(results[1].output == (dir / "out" / "song-3.ppm").string());
+	REQUIRE(results[2].output == (dir / "out" / "song-2.ppm").string());
+	for( std::size_t i = 0; i < results.size(); i++ ) {
+		REQUIRE(results[i].ok);
+		REQUIRE(results[i].input == inputs[i]);
+		std::stringstream text{songs[i].second};
+		std::stringstream expected;
+		expected << render_song(read_song(text));
+		std::stringstream written;
+		written << std::ifstream{results[i].output}.rdbuf();
+		REQUIRE(written.str() == expected.str());
+	}
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Session", "[session]"){
+	const auto dir{std::filesystem::temp_directory_path() / "songsim_session_test"};
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	const auto text{(dir / "in.txt").string()};
+	const auto state{(dir / "state").string()};
+	const auto image{(dir / "out.ppm").string()};
+
+	const std::vector<std::string> parts{"paul pat paul ", "pat rob pa", "ul rob\n", "", "x y z paul\n"};
+	std::string so_far;
+	for( const auto &part : parts ) {
+		so_far += part;
+		std::ofstream{text, std::ios::app} << part;
+		const auto update{update_session(state, text, image)};
+
+		// The half written word at the end is left for next time
+		std::stringstream complete{so_far.substr(0, so_far.find_last_of(" \n") + 1)};
+		const auto s{read_song(complete)};
+		REQUIRE(update.words == s.word_num);
+
+		auto expected{render_song(s)};
+		auto drawn{read_p6(image)};
+		REQUIRE(drawn.size() == expected.size());
+		for( int row = 0; row < s.word_num; row++ ) {
+			REQUIRE(drawn[row] == expected[row]);
+		}
+	}
+
+	// Replacing the text rather than adding to it starts again
+	std::ofstream{text, std::ios::trunc} << "a b\n";
+	const auto update{update_session(state, text, image)};
+	REQUIRE(update.old_words == 0);
+	REQUIRE(update.words == 2);
+
+	// A corrupt or cut short session, with the image it goes with, is thrown away and drawn again
+	std::ofstream{text, std::ios::trunc} << "a b a\n";
+	update_session(state, text, image);
+	const auto corrupt = [&](const std::uint32_t length, const std::uint64_t count, const std::vector<int> &indices) {
+		std::ofstream out{state, std::ios::binary | std::ios::trunc};
+		const auto offset = std::uint64_t{6};
+		const auto words = std::int32_t{3};
+		const auto distinct = std::uint64_t{1};
+		out.write("SONGSIM1", 9);
+		out.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+		out.write(reinterpret_cast<const char *>(&words), sizeof(words));
+		out.write(reinterpret_cast<const char *>(&distinct), sizeof(distinct));
+		out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+		out.write("a", 1);
+		out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+		out.write(reinterpret_cast<const char *>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(int)));
+	};
+	std::stringstream aba{"a b a\n"};
+	const auto expected{render_song(read_song(aba))};
+	struct corruption {
+		std::uint32_t 		length;
+		std::uint64_t 		count;
+		std::vector<int> 	indices;
+	};
+	const std::vector<corruption> corruptions{
+		{0xffffffff, 2, {0, 2}},	// A word longer than the file
+		{1, 0, {}},					// A word that never occurs
+		{1, 2, {0, 1000}},			// Past the end of the image
+		{1, 2, {0, -1}},			// Before the start
+		{1, 2, {2, 0}},				// Out of order
+		{1, 2, {0}},				// Cut short
+	};
+	for( const auto &c: corruptions ) {
+		corrupt(c.length, c.count, c.indices);
+		const auto redrawn{update_session(state, text, image)};
+		REQUIRE(redrawn.old_words == 0);
+		REQUIRE(redrawn.words == 3);
+		const auto drawn{read_p6(image)};
+		for( int row = 0; row < 3; row++ ) {
+			REQUIRE(drawn[row] == expected[row]);
+		}
+	}
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Input hashing", "[hash]"){
+	const auto h{input_hash("one two one", "")};
+	REQUIRE(h == input_hash("one two one", ""));
+	REQUIRE(h != input_hash("one two one", "max-size=2x2 aggregate=mean"));
+	REQUIRE(h != input_hash("one two on", "e"));
+
+	// Embedded as a comment, which readers skip
+	std::stringstream in{"one two one"};
+	const auto s{read_song(in)};
+	std::stringstream out;
+	write_song(s, plan_render(s, 0, 1, strategy::SPARSE), out, ppm_image::format::P3, 1, {}, "songsim input " + hash_hex(h));
+	REQUIRE(out.str().rfind("P3\n# songsim input " + hash_hex(h) + "\n3 3\n255\n", 0) == 0);
+}
+
+TEST_CASE("Tracing", "[trace]"){
+	const auto timeline = [] {
+		auto out = std::ostringstream{};
+		tracer::write(out);
+		return out.str();
+	};
+
+	{ const auto span = trace_span{"before enabling"}; }
+	REQUIRE(timeline().find("before enabling") == std::string::npos);
+
+	tracer::enable();
+	auto s = song{};
+	auto in = std::istringstream{"one two one three two one"};
+	add_words(s, in);
+	{ const auto span = trace_span{"whole render"}; render_song(s, 2); }
+
+	const auto json = timeline();
+	REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+	REQUIRE(json.find("\"name\": \"whole render\", \"ph\": \"X\"") != std::string::npos);
+	REQUIRE(json.find("\"name\": \"render band 0\"") != std::string::npos);
+	REQUIRE(json.find("\"name\": \"render band 1\"") != std::string::npos);
+	REQUIRE(json.find("before enabling") == std::string::npos);
+}
+
+TEST_CASE("Stats", "[stats]"){
+	auto stats = run_stats{};
+	stats.tokens = 100;
+	stats.pixels = 400;
+	stats.time("tokenize", [] {});
+	stats.time("colour", [] {});
+
+	auto text = std::ostringstream{};
+	stats.write_text(text);
+	auto json = std::ostringstream{};
+	stats.write_json(json);
+
+	// Both give the rates by the same names
+	for( const auto *name: {"tokens_per_second", "pixels_per_second", "total_seconds", "peak_rss_bytes"} ) {
+		REQUIRE(text.str().find(std::string{name} + " ") != std::string::npos);
+		REQUIRE(json.str().find("\"" + std::string{name} + "\": ") != std::string::npos);
+	}
+}